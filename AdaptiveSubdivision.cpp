@@ -0,0 +1,358 @@
+#include "AdaptiveSubdivision.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+#include <opensubdiv/far/patchTableFactory.h>
+#include <opensubdiv/far/ptexIndices.h>
+#include <opensubdiv/far/stencilTableFactory.h>
+#include <opensubdiv/bfr/parameterization.h>
+#include <opensubdiv/bfr/tessellation.h>
+
+#include "Parallel.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+constexpr int kMaxPatchPoints = 20; // Gregory basis patches are the largest
+
+// Below this many faces the thread hand-off costs more than the work
+constexpr size_t kMinParallelFaces = 1024;
+
+struct LimitSample {
+    glm::vec3 pos{ 0.0f };
+    glm::vec3 du{ 0.0f };
+    glm::vec3 dv{ 0.0f };
+    glm::vec2 uv{ 0.0f };
+};
+
+// Limit surface at coord, given in the Bfr parameterization of base face `face`
+bool evaluateLimitSample(const AdaptiveTopology& topology, const Vertex* points, const Bfr::Parameterization& param,
+    int face, const float coord[2], LimitSample& sample)
+{
+    int ptexFace = topology.ptexFaces[face];
+    float uv[2] = { coord[0], coord[1] };
+    if (param.HasSubFaces()) ptexFace += param.ConvertCoordToNormalizedSubFace(coord, uv);
+
+    const Far::PatchMap::Handle* handle = topology.patchMap->FindPatch(ptexFace, (double)uv[0], (double)uv[1]);
+    if (!handle) return false;
+
+    float wP[kMaxPatchPoints], wDu[kMaxPatchPoints], wDv[kMaxPatchPoints];
+    topology.patchTable->EvaluateBasis(*handle, uv[0], uv[1], wP, wDu, wDv);
+
+    Far::ConstIndexArray cvs = topology.patchTable->GetPatchVertices(*handle);
+    sample = LimitSample();
+    for (int i = 0; i < cvs.size(); ++i) {
+        const Vertex& p = points[cvs[i]];
+        sample.pos += p.pos * wP[i];
+        sample.uv += p.uv * wP[i];
+        sample.du += p.pos * wDu[i];
+        sample.dv += p.pos * wDv[i];
+    }
+    return true;
+}
+
+Vertex toVertex(const LimitSample& sample)
+{
+    Vertex v;
+    v.pos = sample.pos;
+    v.uv = sample.uv;
+    glm::vec3 n = glm::cross(sample.du, sample.dv);
+    float len = glm::length(n);
+    v.normal = len > 1e-10f ? n / len : glm::vec3(0, 1, 0);
+    return v;
+}
+
+// Triangles Bfr emits for a face tessellated uniformly at rate
+size_t estimateTriangles(int faceSize, int rate)
+{
+    size_t r = (size_t)rate;
+    if (faceSize == 3) return r * r;
+    if (faceSize == 4) return 2 * r * r;
+    size_t half = (r + 1) / 2; // n-gons are split into one quad per corner
+    return (size_t)faceSize * 2 * half * half;
+}
+
+int rateFor(float idealRate, float scale, int maxRate)
+{
+    float r = std::ceil(idealRate * scale);
+    if (!(r >= 1.0f)) return 1; // also catches NaN
+    return (int)std::min(r, (float)maxRate);
+}
+
+// Rate each face would need at scale 1, from limit samples at its corners
+float idealFaceRate(const AdaptiveTopology& topology, const Vertex* points, int face, const AdaptiveOptions& options,
+    float curvatureTolerance)
+{
+    const Far::TopologyLevel& base = topology.refiner->GetLevel(0);
+    const int faceSize = base.GetFaceVertices(face).size();
+    Bfr::Parameterization param(topology.scheme, faceSize);
+    if (!param.IsValid()) return 1.0f;
+
+    LimitSample corners[64];
+    const int numCorners = std::min(faceSize, 64);
+    for (int i = 0; i < numCorners; ++i) {
+        float coord[2];
+        param.GetVertexCoord(i, coord);
+        if (!evaluateLimitSample(topology, points, param, face, coord, corners[i])) return 1.0f;
+    }
+
+    float ideal = 0.0f;
+    for (int i = 0; i < numCorners; ++i) {
+        const LimitSample& a = corners[i];
+        const LimitSample& b = corners[(i + 1) % numCorners];
+        if (options.metric == AdaptiveMetric::Curvature) {
+            // Sagitta of an arc with chord L turning by theta: about L * theta / 8. Halving the
+            // segment length quarters it, so the rate grows with the square root of the error.
+            glm::vec3 na = toVertex(a).normal, nb = toVertex(b).normal;
+            float theta = std::acos(std::clamp(glm::dot(na, nb), -1.0f, 1.0f));
+            float error = glm::length(b.pos - a.pos) * theta / 8.0f;
+            ideal = std::max(ideal, std::sqrt(error / curvatureTolerance));
+        }
+        else {
+            glm::vec4 ca = options.viewProjection * glm::vec4(a.pos, 1.0f);
+            glm::vec4 cb = options.viewProjection * glm::vec4(b.pos, 1.0f);
+            if (ca.w <= 0.0f || cb.w <= 0.0f) continue; // behind the camera
+            glm::vec2 pa = glm::vec2(ca.x, ca.y) / ca.w;
+            glm::vec2 pb = glm::vec2(cb.x, cb.y) / cb.w;
+            float pixels = glm::length(pb - pa) * 0.5f * options.viewportHeight;
+            ideal = std::max(ideal, pixels / options.pixelsPerEdge);
+        }
+    }
+    return ideal;
+}
+
+}
+
+std::unique_ptr<AdaptiveTopology> createAdaptiveTopology(const MeshData& mesh, Sdc::SchemeType scheme, int isolationLevel)
+{
+    auto topology = std::make_unique<AdaptiveTopology>();
+    topology->scheme = scheme;
+    topology->isolationLevel = isolationLevel;
+
+    topology->refiner = createTopologyRefiner(mesh, scheme);
+    if (!topology->refiner) {
+        std::cerr << "[AdaptiveSubdivision] Error: failed to create topology refiner\n";
+        return nullptr;
+    }
+
+    Far::TopologyRefiner::AdaptiveOptions adaptiveOptions(isolationLevel);
+    adaptiveOptions.useInfSharpPatch = true;
+    topology->refiner->RefineAdaptive(adaptiveOptions);
+
+    Far::PatchTableFactory::Options patchOptions(isolationLevel);
+    patchOptions.SetEndCapType(Far::PatchTableFactory::Options::ENDCAP_GREGORY_BASIS);
+    patchOptions.useInfSharpPatch = true;
+    patchOptions.generateVaryingTables = false;
+    topology->patchTable.reset(Far::PatchTableFactory::Create(*topology->refiner, patchOptions));
+    if (!topology->patchTable) {
+        std::cerr << "[AdaptiveSubdivision] Error: failed to create patch table\n";
+        return nullptr;
+    }
+
+    // Patch points index the base cage, then every refined level, then the end-cap local points
+    Far::StencilTableFactory::Options stencilOptions;
+    stencilOptions.generateOffsets = true;
+    stencilOptions.generateIntermediateLevels = true;
+    stencilOptions.factorizeIntermediateLevels = true;
+    const Far::StencilTable* stencils = Far::StencilTableFactory::Create(*topology->refiner, stencilOptions);
+    if (const Far::StencilTable* localPoints = topology->patchTable->GetLocalPointStencilTable()) {
+        const Far::StencilTable* combined = Far::StencilTableFactory::AppendLocalPointStencilTable(*topology->refiner, stencils, localPoints);
+        if (combined) {
+            delete stencils;
+            stencils = combined;
+        }
+    }
+    topology->stencils.reset(stencils);
+
+    topology->patchMap = std::make_unique<const Far::PatchMap>(*topology->patchTable);
+
+    Far::PtexIndices ptexIndices(*topology->refiner);
+    const int numFaces = topology->refiner->GetLevel(0).GetNumFaces();
+    topology->ptexFaces.resize(numFaces);
+    for (int f = 0; f < numFaces; ++f) topology->ptexFaces[f] = ptexIndices.GetFaceId(f);
+
+    for (int a = 0; a < topology->patchTable->GetNumPatchArrays(); ++a) {
+        Far::PatchDescriptor::Type type = topology->patchTable->GetPatchArrayDescriptor(a).GetType();
+        size_t count = (size_t)topology->patchTable->GetNumPatches(a);
+        if (type == Far::PatchDescriptor::REGULAR || type == Far::PatchDescriptor::LOOP) topology->numRegularPatches += count;
+        else topology->numIrregularPatches += count;
+    }
+    return topology;
+}
+
+void evaluatePatchPoints(const AdaptiveTopology& topology, const MeshData& mesh, std::vector<Vertex>& patchPoints, unsigned int numThreads)
+{
+    fillControlVertices(mesh, patchPoints);
+    const size_t numBase = patchPoints.size();
+    if (!topology.stencils) return;
+
+    patchPoints.resize(numBase + (size_t)topology.stencils->GetNumStencils());
+    evaluateStencils(*topology.stencils, patchPoints.data(), patchPoints.data() + numBase, numThreads);
+}
+
+bool tessellateAdaptive(const AdaptiveTopology& topology, const std::vector<Vertex>& patchPoints,
+    const AdaptiveOptions& options, AdaptiveTessellation& out, unsigned int numThreads)
+{
+    const Far::TopologyLevel& base = topology.refiner->GetLevel(0);
+    const int numFaces = base.GetNumFaces();
+    const int numEdges = base.GetNumEdges();
+    const size_t numBaseVerts = (size_t)base.GetNumVertices();
+    const Vertex* points = patchPoints.data();
+    if (patchPoints.size() < numBaseVerts) return false;
+
+    const unsigned int faceThreads = (size_t)numFaces < kMinParallelFaces ? 1 : numThreads;
+    const int maxRate = std::max(1, options.maxTessellationRate);
+
+    // Curvature tolerance is relative to the size of the model
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (size_t v = 0; v < numBaseVerts; ++v) {
+        lo = glm::min(lo, points[v].pos);
+        hi = glm::max(hi, points[v].pos);
+    }
+    float diagonal = numBaseVerts ? glm::length(hi - lo) : 1.0f;
+    float curvatureTolerance = std::max(options.curvatureTolerance * diagonal, 1e-12f);
+
+    // 1. Ideal rate per face from the metric
+    std::vector<float> ideal(numFaces);
+    parallelFor(0, (size_t)numFaces, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f)
+            ideal[f] = idealFaceRate(topology, points, (int)f, options, curvatureTolerance);
+    }, faceThreads);
+
+    // 2. One global scale so the estimated triangle count fits the budget
+    auto estimateAt = [&](float scale) {
+        size_t total = 0;
+        for (int f = 0; f < numFaces; ++f)
+            total += estimateTriangles(base.GetFaceVertices(f).size(), rateFor(ideal[f], scale, maxRate));
+        return total;
+    };
+    out.rateScale = 1.0f;
+    if (estimateAt(1.0f) > options.triangleBudget) {
+        float lowScale = 0.0f, highScale = 1.0f;
+        for (int i = 0; i < 32; ++i) {
+            float mid = 0.5f * (lowScale + highScale);
+            if (estimateAt(mid) <= options.triangleBudget) lowScale = mid;
+            else highScale = mid;
+        }
+        out.rateScale = lowScale;
+        if (estimateAt(0.0f) > options.triangleBudget)
+            std::cerr << "[AdaptiveSubdivision] Warning: budget of " << options.triangleBudget << " triangles is below the base mesh\n";
+    }
+
+    out.faceRates.resize(numFaces);
+    std::vector<int> edgeRates(numEdges, 1);
+    for (int f = 0; f < numFaces; ++f) {
+        out.faceRates[f] = rateFor(ideal[f], out.rateScale, maxRate);
+        Far::ConstIndexArray faceEdges = base.GetFaceEdges(f);
+        for (int i = 0; i < faceEdges.size(); ++i) edgeRates[faceEdges[i]] = std::max(edgeRates[faceEdges[i]], out.faceRates[f]);
+    }
+
+    Bfr::Tessellation::Options tessOptions;
+    tessOptions.SetFacetSize(3);
+
+    auto makeTessellation = [&](int f, std::vector<int>& rates) {
+        Far::ConstIndexArray faceEdges = base.GetFaceEdges(f);
+        rates.resize(faceEdges.size() + 1);
+        for (int i = 0; i < faceEdges.size(); ++i) rates[i] = edgeRates[faceEdges[i]];
+        rates[faceEdges.size()] = out.faceRates[f];
+        return Bfr::Tessellation(Bfr::Parameterization(topology.scheme, faceEdges.size()), (int)rates.size(), rates.data(), tessOptions);
+    };
+
+    // 3. Output layout: base vertices, then the interior points of every edge, then face interiors.
+    // Points on an edge are numbered along the edge's own direction so both faces agree.
+    std::vector<size_t> faceInterior(numFaces + 1, 0), faceFacets(numFaces + 1, 0);
+    parallelFor(0, (size_t)numFaces, [&](size_t begin, size_t end) {
+        std::vector<int> rates;
+        for (size_t f = begin; f < end; ++f) {
+            Bfr::Tessellation tess = makeTessellation((int)f, rates);
+            faceInterior[f + 1] = tess.IsValid() ? (size_t)tess.GetNumInteriorCoords() : 0;
+            faceFacets[f + 1] = tess.IsValid() ? (size_t)tess.GetNumFacets() : 0;
+        }
+    }, faceThreads);
+
+    std::vector<size_t> edgeOffsets(numEdges + 1);
+    edgeOffsets[0] = numBaseVerts;
+    for (int e = 0; e < numEdges; ++e) edgeOffsets[e + 1] = edgeOffsets[e] + (size_t)(edgeRates[e] - 1);
+    faceInterior[0] = edgeOffsets[numEdges];
+    for (int f = 0; f < numFaces; ++f) {
+        faceInterior[f + 1] += faceInterior[f];
+        faceFacets[f + 1] += faceFacets[f];
+    }
+
+    out.verts.assign(faceInterior[numFaces], Vertex{});
+    out.indices.assign(faceFacets[numFaces] * 3, 0);
+
+    // 4. Every face evaluates its interior plus the corners and edges it owns (first incident face)
+    std::atomic<bool> ok{ true };
+    parallelFor(0, (size_t)numFaces, [&](size_t begin, size_t end) {
+        std::vector<int> rates, facets;
+        std::vector<float> coords;
+        std::vector<unsigned int> ids;
+        for (size_t fi = begin; fi < end; ++fi) {
+            const int f = (int)fi;
+            Bfr::Tessellation tess = makeTessellation(f, rates);
+            if (!tess.IsValid()) continue;
+
+            Far::ConstIndexArray faceVerts = base.GetFaceVertices(f);
+            Far::ConstIndexArray faceEdges = base.GetFaceEdges(f);
+            Bfr::Parameterization param(topology.scheme, faceVerts.size());
+
+            const int numCoords = tess.GetNumCoords();
+            const int numBoundary = tess.GetNumBoundaryCoords();
+            coords.resize((size_t)numCoords * 2);
+            tess.GetCoords(coords.data());
+            ids.resize(numCoords);
+
+            int expectedBoundary = 0;
+            for (int i = 0; i < faceEdges.size(); ++i) expectedBoundary += edgeRates[faceEdges[i]];
+            if (expectedBoundary != numBoundary) {
+                ok = false;
+                continue;
+            }
+
+            // Boundary coords run corner 0, edge 0 interior, corner 1, edge 1 interior, ...
+            int b = 0;
+            for (int i = 0; i < faceVerts.size(); ++i) {
+                Far::Index v = faceVerts[i];
+                Far::Index e = faceEdges[i];
+                bool ownsVertex = base.GetVertexFaces(v)[0] == f;
+                bool ownsEdge = base.GetEdgeFaces(e)[0] == f;
+                bool forward = base.GetEdgeVertices(e)[0] == v;
+                int rate = edgeRates[e];
+
+                ids[b] = (unsigned int)v;
+                if (ownsVertex) {
+                    LimitSample s;
+                    if (evaluateLimitSample(topology, points, param, f, &coords[b * 2], s)) out.verts[v] = toVertex(s);
+                }
+                ++b;
+                for (int k = 1; k < rate; ++k, ++b) {
+                    int along = forward ? k : rate - k;
+                    ids[b] = (unsigned int)(edgeOffsets[e] + (size_t)(along - 1));
+                    LimitSample s;
+                    if (ownsEdge && evaluateLimitSample(topology, points, param, f, &coords[b * 2], s)) out.verts[ids[b]] = toVertex(s);
+                }
+            }
+            for (int c = numBoundary; c < numCoords; ++c) {
+                ids[c] = (unsigned int)(faceInterior[f] + (size_t)(c - numBoundary));
+                LimitSample s;
+                if (evaluateLimitSample(topology, points, param, f, &coords[c * 2], s)) out.verts[ids[c]] = toVertex(s);
+            }
+
+            facets.resize((size_t)tess.GetNumFacets() * 3);
+            tess.GetFacets(facets.data());
+            unsigned int* dst = out.indices.data() + faceFacets[f] * 3;
+            for (size_t i = 0; i < facets.size(); ++i) dst[i] = ids[facets[i]];
+        }
+    }, faceThreads);
+
+    if (!ok) {
+        std::cerr << "[AdaptiveSubdivision] Error: unexpected boundary layout from Bfr::Tessellation\n";
+        return false;
+    }
+    return true;
+}
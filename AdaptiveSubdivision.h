@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <opensubdiv/far/topologyRefiner.h>
+#include <opensubdiv/far/patchTable.h>
+#include <opensubdiv/far/patchMap.h>
+#include <opensubdiv/far/stencilTable.h>
+
+#include "Subdivision.h"
+
+// How the per-face tessellation rate is chosen before the budget is applied
+enum class AdaptiveMetric {
+    Curvature,   // deviation of the limit surface from the flat face
+    ScreenSpace, // projected edge length in pixels
+};
+
+struct AdaptiveOptions {
+    size_t triangleBudget = 1000000;
+    int maxTessellationRate = 32;
+    AdaptiveMetric metric = AdaptiveMetric::Curvature;
+
+    // Curvature: allowed deviation, relative to the bounding box diagonal
+    float curvatureTolerance = 1e-4f;
+
+    // ScreenSpace: camera used to project the limit surface
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    float viewportHeight = 1080.0f;
+    float pixelsPerEdge = 8.0f;
+};
+
+// Feature-adaptive refinement of one mesh: only extraordinary vertices and features are
+// isolated, everything else is covered by regular patches of the base cage
+struct AdaptiveTopology {
+    OpenSubdiv::Sdc::SchemeType scheme = OpenSubdiv::Sdc::SCHEME_LOOP;
+    int isolationLevel = 0;
+    std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> refiner;
+    std::unique_ptr<const OpenSubdiv::Far::PatchTable> patchTable;
+    std::unique_ptr<const OpenSubdiv::Far::PatchMap> patchMap;
+    std::unique_ptr<const OpenSubdiv::Far::StencilTable> stencils; // base cage -> refined vertices + local points
+    std::vector<int> ptexFaces;                                      // first ptex face of every base face
+    size_t numRegularPatches = 0;
+    size_t numIrregularPatches = 0;
+};
+
+struct AdaptiveTessellation {
+    std::vector<Vertex> verts;         // limit positions, normals from the limit tangents
+    std::vector<unsigned int> indices; // triangles
+    std::vector<int> faceRates;        // inner rate chosen for every base face
+    float rateScale = 1.0f;            // < 1 when the metric was scaled down to meet the budget
+};
+
+// RefineAdaptive + PatchTableFactory (Gregory end caps) + stencils for every patch point
+std::unique_ptr<AdaptiveTopology> createAdaptiveTopology(const MeshData& mesh, OpenSubdiv::Sdc::SchemeType scheme, int isolationLevel);
+
+// Evaluates all patch points (base cage, refined vertices and local points) for the current base positions
+void evaluatePatchPoints(const AdaptiveTopology& topology, const MeshData& mesh, std::vector<Vertex>& patchPoints, unsigned int numThreads = 0);
+
+// Picks a rate per base face from the metric, scales all rates down until the estimate fits the
+// triangle budget, and tessellates every face on the limit surface. Edge rates are shared by both
+// faces of an edge, so the result is watertight and boundary vertices are emitted once.
+bool tessellateAdaptive(const AdaptiveTopology& topology, const std::vector<Vertex>& patchPoints,
+    const AdaptiveOptions& options, AdaptiveTessellation& out, unsigned int numThreads = 0);
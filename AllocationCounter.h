@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Process-wide count of global operator new calls (every variant) since startup. The replacement
+// operators live in AllocationCounter.cpp, which only executables that want the hook compile
+// (SubdivBench); SubdivCore and the viewer keep the default allocator.
+struct AllocationCounts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+AllocationCounts allocationCounts();
+
+// Counts between construction and Elapsed(); includes every thread (the global pool too)
+class AllocationScope {
+public:
+    AllocationScope() : start(allocationCounts()) {}
+    AllocationCounts Elapsed() const
+    {
+        AllocationCounts now = allocationCounts();
+        return { now.allocations - start.allocations, now.bytes - start.bytes };
+    }
+
+private:
+    AllocationCounts start;
+};
@@ -0,0 +1,88 @@
+#include "AnimatedSubdivision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MeshPrimitives.h"
+#include "Parallel.h"
+#include "SubdivisionCache.h"
+#include "Trace.h"
+
+namespace {
+
+// Below this many cage vertices the deformer stays on the calling thread
+constexpr size_t kMinParallelCageVertices = 16384;
+
+}
+
+CageDeformer makeWaveDeformer(const MeshData& rest, float amplitude, float frequency, float speed)
+{
+    glm::vec3 lo(0.0f), hi(0.0f);
+    if (!rest.vertices.empty()) {
+        lo = hi = rest.vertices[0];
+        for (const glm::vec3& p : rest.vertices) {
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+    }
+    const float diagonal = std::max(glm::length(hi - lo), 1e-6f);
+    const float height = amplitude * diagonal;
+    const float waveNumber = 2.0f * 3.14159265f * frequency / diagonal;
+    const glm::vec3 direction = glm::normalize(glm::vec3(1.0f, 0.6f, 0.3f));
+
+    return [=](const MeshData& mesh, float time, std::vector<Vertex>& controlVerts) {
+        const size_t count = std::min(controlVerts.size(), mesh.vertices.size());
+        const bool haveNormals = mesh.normals.size() >= count;
+        parallelFor(0, count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const glm::vec3& p = mesh.vertices[i];
+                glm::vec3 n = haveNormals ? mesh.normals[i] : glm::vec3(0.0f);
+                controlVerts[i].pos = p + n * (height * std::sin(waveNumber * glm::dot(p - lo, direction) - speed * time));
+            }
+        }, count < kMinParallelCageVertices ? 1 : 0);
+    };
+}
+
+AnimatedSubdivision::AnimatedSubdivision(std::shared_ptr<const MeshData> mesh, std::shared_ptr<const SubdivTopology> topology,
+    unsigned int numThreads)
+    : mesh(std::move(mesh)), topology(std::move(topology)), numThreads(numThreads), channels(primvarChannelsFor(*this->mesh))
+{
+    fillControlVertices(*this->mesh, controlVerts);
+
+    if (!this->topology || !this->topology->stencils || this->topology->level <= 0) {
+        this->topology.reset();
+        const MeshData& base = *this->mesh;
+        triangulateFaces(base.vertsPerFace.data(), base.vertsPerFace.size(), base.indices.data(), 0, baseIndices);
+        buildVertexFaceAdjacency(baseIndices.data(), baseIndices.size() / 3, controlVerts.size(), baseAdjacency);
+        verts = controlVerts;
+    }
+    else {
+        verts.resize((size_t)this->topology->stencils->GetNumStencils());
+    }
+}
+
+const std::vector<unsigned int>& AnimatedSubdivision::GetIndices() const
+{
+    return topology ? topology->indices : baseIndices;
+}
+
+int AnimatedSubdivision::GetLevel() const
+{
+    return topology ? topology->level : 0;
+}
+
+void AnimatedSubdivision::Update(const CageDeformer& deformer, float time)
+{
+    TRACE_SCOPE("deform");
+    if (deformer) deformer(*mesh, time, controlVerts);
+
+    if (!topology) {
+        for (size_t i = 0; i < verts.size(); ++i) verts[i].pos = controlVerts[i].pos;
+        recomputeNormals(verts, baseIndices, baseAdjacency, faceNormals, numThreads);
+        return;
+    }
+    if (verts.empty() || controlVerts.empty()) return;
+    controlChannels.Load(controlVerts.data(), controlVerts.size(), channels);
+    evaluateStencilChannels(*topology->stencils, controlChannels, verts.data(), numThreads);
+    recomputeNormals(verts, topology->indices, topology->adjacency, faceNormals, numThreads);
+}
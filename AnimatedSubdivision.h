@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Normals.h"
+#include "PrimvarChannels.h"
+#include "Subdivision.h"
+
+struct SubdivTopology;
+
+// Writes the deformed cage for time (seconds) into controlVerts, which holds one entry per base
+// vertex. Only positions need to be written; uvs keep their rest values.
+using CageDeformer = std::function<void(const MeshData& rest, float time, std::vector<Vertex>& controlVerts)>;
+
+// Travelling sine wave along the rest normals. amplitude is a fraction of the cage's bounding box
+// diagonal, frequency counts waves across that diagonal, speed is in radians per second.
+CageDeformer makeWaveDeformer(const MeshData& rest, float amplitude = 0.02f, float frequency = 4.0f, float speed = 3.0f);
+
+// Per-frame deformation of one mesh at one level. Topology, stencils, triangle list and adjacency
+// are built once (shared with the SubdivisionCache); each Update only rewrites the control
+// positions, runs the stencil pass and recomputes normals into the same output buffer, so the
+// vertex count and the buffer address stay fixed from frame to frame.
+class AnimatedSubdivision {
+public:
+    // topology == nullptr animates the cage itself (level 0)
+    AnimatedSubdivision(std::shared_ptr<const MeshData> mesh, std::shared_ptr<const SubdivTopology> topology,
+        unsigned int numThreads = 0);
+    AnimatedSubdivision(const AnimatedSubdivision&) = delete;
+    AnimatedSubdivision& operator=(const AnimatedSubdivision&) = delete;
+
+    void Update(const CageDeformer& deformer, float time);
+
+    const std::vector<Vertex>& GetVertices() const { return verts; }
+    const std::vector<unsigned int>& GetIndices() const;
+    const std::shared_ptr<const MeshData>& GetMesh() const { return mesh; }
+    int GetLevel() const;
+
+private:
+    std::shared_ptr<const MeshData> mesh;
+    std::shared_ptr<const SubdivTopology> topology;
+    unsigned int numThreads;
+
+    std::vector<Vertex> controlVerts; // cage in primvar layout; positions rewritten every frame
+    unsigned int channels;            // blended by the stencil pass; normals are recomputed
+    PrimvarBuffer controlChannels;    // controlVerts reloaded per frame into the stencil kernel's layout
+    std::vector<Vertex> verts;        // persistent output
+    FaceNormalsSoA faceNormals;       // recomputeNormals scratch, sized by the first frame
+
+    // Level 0 only: the cage's own triangles
+    std::vector<unsigned int> baseIndices;
+    VertexFaceAdjacency baseAdjacency;
+};
@@ -0,0 +1,134 @@
+#include "IncrementalSubdivision.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+
+#include "PrimvarChannels.h"
+#include "StreamingSubdivision.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+size_t RefinedLevel::MemoryBytes() const
+{
+    size_t bytes = verts.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int)
+        + (adjacency.offsets.capacity() + adjacency.faces.capacity()) * sizeof(unsigned int);
+    // The refiner keeps both of its levels in full and is usually the largest part
+    if (refiner) {
+        for (int l = 0; l < refiner->GetNumLevels(); ++l) bytes += estimateTopologyLevelBytes(refiner->GetLevel(l));
+    }
+    if (limit) bytes += limit->MemoryBytes();
+    return bytes;
+}
+
+IncrementalSubdivision::IncrementalSubdivision(std::shared_ptr<const MeshData> mesh, Sdc::SchemeType scheme)
+    : mesh(std::move(mesh)), scheme(scheme)
+{
+}
+
+const RefinedLevel* IncrementalSubdivision::GetLevel(int level, const std::atomic<bool>* cancelled)
+{
+    if (!mesh || level <= 0) return nullptr;
+
+    if (auto it = levels.find(level); it != levels.end()) {
+        stats.levelsServed++;
+        Evict(level);
+        return it->second.get();
+    }
+
+    // Closest retained level below the target (0 is the base cage)
+    int from = 0;
+    if (auto it = levels.lower_bound(level); it != levels.begin()) from = std::prev(it)->first;
+
+    for (int l = from; l < level; ++l) {
+        if (cancelled && cancelled->load()) return nullptr;
+        std::unique_ptr<RefinedLevel> next = RefineNext(l);
+        if (!next) return nullptr;
+        stats.levelsRefined++;
+        levels[l + 1] = std::move(next);
+    }
+    Evict(level);
+    return levels[level].get();
+}
+
+const RefinedLevel* IncrementalSubdivision::GetLimit(int level, const std::atomic<bool>* cancelled)
+{
+    RefinedLevel* refined = const_cast<RefinedLevel*>(GetLevel(level, cancelled));
+    if (!refined || refined->limit) return refined;
+
+    auto masks = std::make_unique<LimitMasks>();
+    if (buildLimitMasks(*refined->refiner, *masks)) refined->limit = std::move(masks);
+    return refined;
+}
+
+std::unique_ptr<RefinedLevel> IncrementalSubdivision::RefineNext(int fromLevel) const
+{
+    auto next = std::make_unique<RefinedLevel>();
+    next->level = fromLevel + 1;
+
+    // Level 0 comes from the cage; any other level was retained (GetLevel only steps from those)
+    std::vector<Vertex> controlVerts;
+    const std::vector<Vertex>* source = &controlVerts;
+    if (fromLevel == 0) {
+        next->refiner = createTopologyRefiner(*mesh, scheme);
+        fillControlVertices(*mesh, controlVerts);
+    }
+    else {
+        const RefinedLevel& prev = *levels.at(fromLevel);
+        next->refiner = createTopologyRefiner(prev.refiner->GetLevel(1), scheme);
+        source = &prev.verts;
+    }
+    if (!next->refiner) {
+        std::cerr << "[IncrementalSubdivision] Error: failed to create topology refiner for level " << fromLevel << "\n";
+        return nullptr;
+    }
+
+    // One level at a time; full topology so the next step and the normal gather can read it
+    {
+        TRACE_SCOPE("refine");
+        Far::TopologyRefiner::UniformOptions refineOptions(1);
+        refineOptions.fullTopologyInLastLevel = true;
+        next->refiner->RefineUniform(refineOptions);
+    }
+
+    const Far::TopologyLevel& refinedLevel = next->refiner->GetLevel(1);
+    next->verts.resize((size_t)refinedLevel.GetNumVertices());
+    if (next->verts.empty() || source->empty()) {
+        std::cerr << "[IncrementalSubdivision] Error: level " << next->level << " has no vertices\n";
+        return nullptr;
+    }
+    // Normals are recomputed below, so they are not blended
+    interpolatePrimvarChannels(*next->refiner, 0, 1, source->data(), next->verts.data(), primvarChannelsFor(*mesh));
+
+    extractTriangleIndices(refinedLevel, 0, next->indices);
+    if (!buildVertexFaceAdjacency(refinedLevel, next->adjacency)) {
+        buildVertexFaceAdjacency(next->indices.data(), next->indices.size() / 3, next->verts.size(), next->adjacency);
+    }
+    recomputeNormals(next->verts, next->indices, next->adjacency);
+    return next;
+}
+
+void IncrementalSubdivision::Evict(int keepLevel)
+{
+    if (maxRetainedLevels == 0) return;
+    while (levels.size() > maxRetainedLevels) {
+        // Farthest from the level in use; ties drop the higher (more expensive to hold) one
+        auto victim = levels.end();
+        for (auto it = levels.begin(); it != levels.end(); ++it) {
+            if (it->first == keepLevel) continue;
+            if (victim == levels.end() || std::abs(it->first - keepLevel) >= std::abs(victim->first - keepLevel)) victim = it;
+        }
+        if (victim == levels.end()) break;
+        levels.erase(victim);
+        stats.evictions++;
+    }
+}
+
+IncrementalSubdivision::Stats IncrementalSubdivision::GetStats() const
+{
+    Stats s = stats;
+    s.retainedLevels = levels.size();
+    for (const auto& [level, refined] : levels) s.retainedBytes += refined->MemoryBytes();
+    return s;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include "LimitSurface.h"
+#include "Normals.h"
+#include "Subdivision.h"
+
+// One refined level, produced from the level below it
+struct RefinedLevel {
+    int level = 0;
+    std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> refiner; // (level - 1) -> level, full topology in its last level
+    std::vector<Vertex> verts;                                 // subdivided positions with smooth normals
+    std::vector<unsigned int> indices;
+    VertexFaceAdjacency adjacency;
+    std::unique_ptr<const LimitMasks> limit;                   // built on first GetLimit
+
+    size_t MemoryBytes() const;
+};
+
+// Persistent per-mesh subdivision state. Stepping up refines and interpolates only the new levels,
+// starting from the closest retained level below; stepping down to a retained level is free.
+// Retention trades memory for latency: evicted levels are rebuilt from the closest one kept.
+class IncrementalSubdivision {
+public:
+    struct Stats {
+        size_t levelsRefined = 0; // single-level refinements performed
+        size_t levelsServed = 0;  // requests answered from a retained level
+        size_t evictions = 0;
+        size_t retainedLevels = 0;
+        size_t retainedBytes = 0;
+    };
+
+    explicit IncrementalSubdivision(std::shared_ptr<const MeshData> mesh,
+        OpenSubdiv::Sdc::SchemeType scheme = OpenSubdiv::Sdc::SCHEME_LOOP);
+    IncrementalSubdivision(const IncrementalSubdivision&) = delete;
+    IncrementalSubdivision& operator=(const IncrementalSubdivision&) = delete;
+
+    // Returns level >= 1, refining what is missing. nullptr on failure or when cancelled is raised
+    // between levels (levels finished so far are kept). The pointer is valid until the next call.
+    const RefinedLevel* GetLevel(int level, const std::atomic<bool>* cancelled = nullptr);
+
+    // GetLevel plus the limit masks of that level, built once and retained with it
+    const RefinedLevel* GetLimit(int level, const std::atomic<bool>* cancelled = nullptr);
+
+    // Refined levels kept at once (0: no limit). The requested level is always kept;
+    // beyond that the levels farthest from it go first.
+    void SetMaxRetainedLevels(size_t count) { maxRetainedLevels = count; }
+    size_t GetMaxRetainedLevels() const { return maxRetainedLevels; }
+
+    const std::shared_ptr<const MeshData>& GetMesh() const { return mesh; }
+    OpenSubdiv::Sdc::SchemeType GetScheme() const { return scheme; }
+    Stats GetStats() const;
+
+private:
+    std::unique_ptr<RefinedLevel> RefineNext(int fromLevel) const;
+    void Evict(int keepLevel);
+
+    std::shared_ptr<const MeshData> mesh;
+    OpenSubdiv::Sdc::SchemeType scheme;
+    size_t maxRetainedLevels = 0;
+    std::map<int, std::unique_ptr<RefinedLevel>> levels;
+    Stats stats;
+};
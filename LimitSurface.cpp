@@ -0,0 +1,148 @@
+#include "LimitSurface.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <opensubdiv/far/primvarRefiner.h>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+// Below this many vertices the thread hand-off costs more than the work
+constexpr size_t kMinParallelVertices = 16384;
+
+// Stands in for a last-level vertex: PrimvarRefiner only passes it back to AddWithWeight
+struct SourceVertex {
+    unsigned int index;
+};
+
+struct SourceArray {
+    SourceVertex operator[](int index) const { return SourceVertex{ (unsigned int)index }; }
+};
+
+// Records the weights Limit applies into one CSR mask. Limit visits vertices in ascending
+// order and finishes each vertex before the next, so rows can be appended as they arrive.
+class MaskRecorder {
+public:
+    struct Row {
+        MaskRecorder* recorder;
+        unsigned int vert;
+        void Clear(void* = 0) { recorder->Begin(vert); }
+        void AddWithWeight(const SourceVertex& src, float weight) { recorder->Add(src.index, weight); }
+    };
+
+    MaskRecorder(LimitMask& mask, size_t numVerts) : mask(mask), numVerts(numVerts)
+    {
+        mask.offsets.assign(numVerts + 1, 0);
+        mask.indices.clear();
+        mask.weights.clear();
+        // Valence 6 one-ring plus the vertex itself covers the regular case
+        mask.indices.reserve(numVerts * 7);
+        mask.weights.reserve(numVerts * 7);
+    }
+
+    Row operator[](int vert) { return Row{ this, (unsigned int)vert }; }
+
+    void Begin(unsigned int vert)
+    {
+        // A repeated Clear restarts the row; skipped vertices get empty rows
+        if (vert + 1 == next) Truncate(mask.offsets[vert]);
+        while (next <= vert) mask.offsets[next++] = (unsigned int)mask.indices.size();
+    }
+
+    void Add(unsigned int index, float weight)
+    {
+        if (weight == 0.0f) return;
+        mask.indices.push_back(index);
+        mask.weights.push_back(weight);
+    }
+
+    void Finish()
+    {
+        while (next <= numVerts) mask.offsets[next++] = (unsigned int)mask.indices.size();
+        mask.indices.shrink_to_fit();
+        mask.weights.shrink_to_fit();
+    }
+
+private:
+    void Truncate(size_t size)
+    {
+        mask.indices.resize(size);
+        mask.weights.resize(size);
+    }
+
+    LimitMask& mask;
+    size_t numVerts;
+    size_t next = 0;
+};
+
+size_t maskBytes(const LimitMask& mask)
+{
+    return mask.offsets.capacity() * sizeof(unsigned int) + mask.indices.capacity() * sizeof(unsigned int)
+        + mask.weights.capacity() * sizeof(float);
+}
+
+}
+
+size_t LimitMasks::MemoryBytes() const
+{
+    return maskBytes(position) + maskBytes(tangent1) + maskBytes(tangent2);
+}
+
+bool buildLimitMasks(const Far::TopologyRefiner& refiner, LimitMasks& masks)
+{
+    const Far::TopologyLevel& lastLevel = refiner.GetLevel(refiner.GetMaxLevel());
+    const size_t numVerts = (size_t)lastLevel.GetNumVertices();
+    if (numVerts == 0 || lastLevel.GetNumEdges() == 0) {
+        std::cerr << "[LimitSurface] Error: last level has no edge topology (refine with fullTopologyInLastLevel)\n";
+        return false;
+    }
+
+    MaskRecorder position(masks.position, numVerts);
+    MaskRecorder tangent1(masks.tangent1, numVerts);
+    MaskRecorder tangent2(masks.tangent2, numVerts);
+
+    Far::PrimvarRefiner primvarRefiner(refiner);
+    primvarRefiner.Limit(SourceArray(), position, tangent1, tangent2);
+
+    position.Finish();
+    tangent1.Finish();
+    tangent2.Finish();
+    return true;
+}
+
+void evaluateLimit(const LimitMasks& masks, const Vertex* refined, Vertex* out, unsigned int numThreads)
+{
+    TRACE_SCOPE("limit");
+    const size_t numVerts = masks.NumVertices();
+    if (numVerts < kMinParallelVertices) numThreads = 1;
+
+    auto apply = [refined](const LimitMask& mask, size_t v, glm::vec3& pos, glm::vec2* uv) {
+        for (unsigned int i = mask.offsets[v]; i < mask.offsets[v + 1]; ++i) {
+            const Vertex& src = refined[mask.indices[i]];
+            float w = mask.weights[i];
+            pos += src.pos * w;
+            if (uv) *uv += src.uv * w;
+        }
+    };
+
+    parallelFor(0, numVerts, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            glm::vec3 pos(0.0f), du(0.0f), dv(0.0f);
+            glm::vec2 uv(0.0f);
+            apply(masks.position, v, pos, &uv);
+            apply(masks.tangent1, v, du, nullptr);
+            apply(masks.tangent2, v, dv, nullptr);
+
+            glm::vec3 n = glm::cross(du, dv);
+            float len = glm::length(n);
+            out[v].pos = pos;
+            out[v].normal = len > 1e-10f ? n / len : glm::vec3(0, 1, 0);
+            out[v].uv = uv;
+        }
+    }, numThreads);
+}
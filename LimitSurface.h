@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include "Subdivision.h"
+
+// One limit mask per vertex of the last refined level, in CSR form over that level's vertices
+struct LimitMask {
+    std::vector<unsigned int> offsets; // numVerts + 1
+    std::vector<unsigned int> indices;
+    std::vector<float> weights;
+};
+
+// Limit position and the two limit tangents; normal = cross(tangent1, tangent2)
+struct LimitMasks {
+    LimitMask position;
+    LimitMask tangent1;
+    LimitMask tangent2;
+
+    size_t NumVertices() const { return position.offsets.empty() ? 0 : position.offsets.size() - 1; }
+    size_t MemoryBytes() const;
+};
+
+// Records the masks PrimvarRefiner::Limit applies to the last level. The refiner must have been
+// refined with fullTopologyInLastLevel. Masks only span a one-ring, so this is cheap next to the stencils.
+bool buildLimitMasks(const OpenSubdiv::Far::TopologyRefiner& refiner, LimitMasks& masks);
+
+// Projects refined last-level vertices onto the limit surface (position and uv) and writes the
+// normal from the limit tangents. Replaces recomputeNormals; refined and out must not alias.
+void evaluateLimit(const LimitMasks& masks, const Vertex* refined, Vertex* out, unsigned int numThreads = 0);
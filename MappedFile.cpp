@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& path)
+{
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> mapped(new MappedFile());
+    mapped->data = (const uint8_t*)view;
+    mapped->size = (size_t)fileSize.QuadPart;
+    mapped->fileHandle = file;
+    mapped->mappingHandle = mapping;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle) CloseHandle((HANDLE)fileHandle);
+}
+
+#else
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> mapped(new MappedFile());
+    mapped->data = (const uint8_t*)view;
+    mapped->size = (size_t)st.st_size;
+    mapped->fd = fd;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data) munmap((void*)data, size);
+    if (fd >= 0) ::close(fd);
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns nullptr if the file cannot be opened or is empty
+    static std::shared_ptr<MappedFile> Open(const std::filesystem::path& path);
+
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
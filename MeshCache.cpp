@@ -0,0 +1,176 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace {
+
+constexpr uint32_t kByteOrderMark = 0x01020304u;
+
+const uint32_t kElementSizes[MESH_SECTION_COUNT] = {
+    sizeof(glm::vec3), sizeof(glm::vec3), sizeof(glm::vec2), sizeof(unsigned int), sizeof(int)
+};
+
+uint64_t alignUp(uint64_t value)
+{
+    return (value + kMeshCacheAlignment - 1) & ~(kMeshCacheAlignment - 1);
+}
+
+// FNV-1a over the whole file
+uint64_t hashFile(const std::filesystem::path& path, bool& ok)
+{
+    ok = false;
+    auto mapped = MappedFile::Open(path);
+    if (!mapped) return 0;
+
+    uint64_t h = 0xCBF29CE484222325ull;
+    const uint8_t* p = mapped->Data();
+    for (size_t i = 0; i < mapped->Size(); ++i) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    ok = true;
+    return h ? h : 1;
+}
+
+template <typename T>
+void viewSection(MeshArray<T>& array, const uint8_t* base, const MeshCacheHeader::Section& section)
+{
+    array.View((const T*)(base + section.offset), (size_t)section.count);
+}
+
+} // namespace
+
+bool describeMeshSource(const std::filesystem::path& sourcePath, bool computeHash, MeshCacheSource& source)
+{
+    std::error_code ec;
+    source.size = (uint64_t)std::filesystem::file_size(sourcePath, ec);
+    if (ec) return false;
+    source.modifiedTime = (int64_t)std::filesystem::last_write_time(sourcePath, ec).time_since_epoch().count();
+    if (ec) return false;
+
+    source.contentHash = 0;
+    if (computeHash) {
+        bool ok;
+        source.contentHash = hashFile(sourcePath, ok);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool writeMeshCache(const std::filesystem::path& cachePath, const MeshData& mesh, const MeshCacheSource& source)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+    MeshCacheHeader header{};
+    std::memcpy(header.magic, kMeshCacheMagic, sizeof(header.magic));
+    header.version = kMeshCacheVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.headerSize = sizeof(MeshCacheHeader);
+    std::memcpy(header.elementSizes, kElementSizes, sizeof(kElementSizes));
+    header.source = source;
+
+    const void* sectionData[MESH_SECTION_COUNT] = {
+        mesh.vertices.data(), mesh.normals.data(), mesh.uvs.data(), mesh.indices.data(), mesh.vertsPerFace.data()
+    };
+    const size_t sectionCounts[MESH_SECTION_COUNT] = {
+        mesh.vertices.size(), mesh.normals.size(), mesh.uvs.size(), mesh.indices.size(), mesh.vertsPerFace.size()
+    };
+
+    uint64_t offset = alignUp(sizeof(MeshCacheHeader));
+    for (int s = 0; s < MESH_SECTION_COUNT; ++s) {
+        header.sections[s].offset = offset;
+        header.sections[s].count = sectionCounts[s];
+        offset = alignUp(offset + sectionCounts[s] * kElementSizes[s]);
+    }
+
+    std::filesystem::path tmpPath = cachePath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        static const char zeros[kMeshCacheAlignment] = {};
+        out.write((const char*)&header, sizeof(header));
+        uint64_t written = sizeof(header);
+        for (int s = 0; s < MESH_SECTION_COUNT; ++s) {
+            out.write(zeros, (std::streamsize)(header.sections[s].offset - written));
+            uint64_t bytes = header.sections[s].count * kElementSizes[s];
+            if (bytes) out.write((const char*)sectionData[s], (std::streamsize)bytes);
+            written = header.sections[s].offset + bytes;
+        }
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<MeshData> loadMeshCache(const std::filesystem::path& cachePath, const MeshCacheSource& expected, bool compareHash)
+{
+    std::shared_ptr<const MappedFile> mapped = MappedFile::Open(cachePath);
+    if (!mapped || mapped->Size() < sizeof(MeshCacheHeader)) return nullptr;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, mapped->Data(), sizeof(header));
+    if (std::memcmp(header.magic, kMeshCacheMagic, sizeof(header.magic)) != 0 ||
+        header.version != kMeshCacheVersion ||
+        header.byteOrderMark != kByteOrderMark ||
+        header.headerSize != sizeof(MeshCacheHeader) ||
+        std::memcmp(header.elementSizes, kElementSizes, sizeof(kElementSizes)) != 0) {
+        return nullptr;
+    }
+
+    if (header.source.size != expected.size || header.source.modifiedTime != expected.modifiedTime) return nullptr;
+    if (compareHash && header.source.contentHash != expected.contentHash) return nullptr;
+
+    for (int s = 0; s < MESH_SECTION_COUNT; ++s) {
+        const auto& section = header.sections[s];
+        if (section.offset % kMeshCacheAlignment != 0 || section.offset > mapped->Size() ||
+            section.count > (mapped->Size() - section.offset) / kElementSizes[s]) {
+            return nullptr;
+        }
+    }
+
+    const uint64_t numVerts = header.sections[MESH_SECTION_VERTICES].count;
+    if (header.sections[MESH_SECTION_NORMALS].count != numVerts || header.sections[MESH_SECTION_UVS].count != numVerts) return nullptr;
+
+    // A file of the right shape can still hold indices that would send OpenSubdiv and the welder out
+    // of range: faces must cover the index section exactly and every index must name a vertex
+    const uint8_t* data = mapped->Data();
+    const auto& faceSection = header.sections[MESH_SECTION_VERTS_PER_FACE];
+    const auto& indexSection = header.sections[MESH_SECTION_INDICES];
+    const int* vertsPerFace = (const int*)(data + faceSection.offset);
+    uint64_t corners = 0;
+    for (uint64_t f = 0; f < faceSection.count; ++f) {
+        if (vertsPerFace[f] <= 0) return nullptr;
+        corners += (uint64_t)vertsPerFace[f];
+    }
+    if (corners != indexSection.count) return nullptr;
+    const unsigned int* indices = (const unsigned int*)(data + indexSection.offset);
+    for (uint64_t i = 0; i < indexSection.count; ++i) {
+        if (indices[i] >= numVerts) return nullptr;
+    }
+
+    auto mesh = std::make_shared<MeshData>();
+    viewSection(mesh->vertices, data, header.sections[MESH_SECTION_VERTICES]);
+    viewSection(mesh->normals, data, header.sections[MESH_SECTION_NORMALS]);
+    viewSection(mesh->uvs, data, header.sections[MESH_SECTION_UVS]);
+    viewSection(mesh->indices, data, header.sections[MESH_SECTION_INDICES]);
+    viewSection(mesh->vertsPerFace, data, header.sections[MESH_SECTION_VERTS_PER_FACE]);
+    mesh->backing = std::move(mapped);
+    return mesh;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "ResourceManager.h"
+
+// Binary mesh cache layout (native endianness, checked through byteOrderMark):
+//   MeshCacheHeader, then the vertices/normals/uvs/indices/vertsPerFace sections, each
+//   contiguous and aligned to kMeshCacheAlignment so a mapped file can be viewed in place.
+constexpr char kMeshCacheMagic[8] = { 'O', 'S', 'B', 'M', 'E', 'S', 'H', '\0' };
+constexpr uint32_t kMeshCacheVersion = 2; // 2: faces keep their arity instead of being triangulated
+constexpr uint64_t kMeshCacheAlignment = 64;
+
+enum MeshCacheSection : int {
+    MESH_SECTION_VERTICES = 0,
+    MESH_SECTION_NORMALS,
+    MESH_SECTION_UVS,
+    MESH_SECTION_INDICES,
+    MESH_SECTION_VERTS_PER_FACE,
+    MESH_SECTION_COUNT
+};
+
+// Identifies the source file a cache entry was built from
+struct MeshCacheSource {
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t contentHash = 0; // 0 when not computed
+};
+
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    uint32_t headerSize;
+    uint32_t elementSizes[MESH_SECTION_COUNT];
+    MeshCacheSource source;
+    struct Section {
+        uint64_t offset;
+        uint64_t count;
+    } sections[MESH_SECTION_COUNT];
+};
+
+// Stats the source file; hashing reads it completely, so it is only done on request
+bool describeMeshSource(const std::filesystem::path& sourcePath, bool computeHash, MeshCacheSource& source);
+
+// Writes through a temporary file and renames it, so readers never see a partial cache
+bool writeMeshCache(const std::filesystem::path& cachePath, const MeshData& mesh, const MeshCacheSource& source);
+
+// Maps a cache file and returns a MeshData viewing it, or nullptr if it is missing, corrupt (including
+// face sizes that do not cover the indices, or indices past the vertex count) or stale
+std::shared_ptr<MeshData> loadMeshCache(const std::filesystem::path& cachePath, const MeshCacheSource& expected, bool compareHash);
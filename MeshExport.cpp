@@ -0,0 +1,129 @@
+#include "MeshExport.h"
+
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "PLY export writes native little-endian records");
+
+#pragma pack(push, 1)
+struct PlyVertex {
+    float x, y, z;
+    float nx, ny, nz;
+    float s, t;
+};
+
+struct PlyTriangle {
+    unsigned char count;
+    unsigned int v[3];
+};
+#pragma pack(pop)
+
+// Records are staged in blocks so large levels are not written one field at a time
+constexpr size_t kBlockRecords = 16384;
+
+}
+
+bool PlyStreamWriter::Open(const std::string& path, size_t numVertices, size_t numTriangles)
+{
+    this->path = path;
+    this->numVertices = numVertices;
+    this->numTriangles = numTriangles;
+    appended = 0;
+
+    const std::string header =
+        "ply\nformat binary_little_endian 1.0\n"
+        "element vertex " + std::to_string(numVertices) + "\n"
+        "property float x\nproperty float y\nproperty float z\n"
+        "property float nx\nproperty float ny\nproperty float nz\n"
+        "property float s\nproperty float t\n"
+        "element face " + std::to_string(numTriangles) + "\n"
+        "property list uchar uint vertex_indices\n"
+        "end_header\n";
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(header.data(), (std::streamsize)header.size());
+        if (!out) {
+            std::cerr << "[MeshExport] Cannot open " << path << " for writing\n";
+            return false;
+        }
+    }
+    vertexOffset = header.size();
+    triangleOffset = vertexOffset + (uint64_t)numVertices * sizeof(PlyVertex);
+
+    // Vertices that are never written read back as zeros
+    std::error_code ec;
+    std::filesystem::resize_file(path, triangleOffset, ec);
+    if (!ec) file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (ec || !file) {
+        std::cerr << "[MeshExport] Cannot size " << path << ": " << (ec ? ec.message() : "open failed") << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool PlyStreamWriter::WriteVertices(size_t first, const Vertex* verts, size_t count)
+{
+    if (first + count > numVertices) {
+        std::cerr << "[MeshExport] Vertex " << first + count - 1 << " out of range in " << path << "\n";
+        return false;
+    }
+    file.seekp((std::streamoff)(vertexOffset + (uint64_t)first * sizeof(PlyVertex)));
+    for (size_t begin = 0; begin < count; begin += kBlockRecords) {
+        const size_t end = std::min(count, begin + kBlockRecords);
+        staging.resize((end - begin) * sizeof(PlyVertex));
+        PlyVertex* records = (PlyVertex*)staging.data();
+        for (size_t i = begin; i < end; ++i) {
+            const Vertex& v = verts[i];
+            records[i - begin] = { v.pos.x, v.pos.y, v.pos.z, v.normal.x, v.normal.y, v.normal.z, v.uv.x, v.uv.y };
+        }
+        file.write(staging.data(), (std::streamsize)staging.size());
+    }
+    return (bool)file;
+}
+
+bool PlyStreamWriter::AppendTriangles(const unsigned int* indices, size_t count)
+{
+    if (appended + count > numTriangles) {
+        std::cerr << "[MeshExport] More triangles than announced in " << path << "\n";
+        return false;
+    }
+    file.seekp((std::streamoff)(triangleOffset + (uint64_t)appended * sizeof(PlyTriangle)));
+    for (size_t begin = 0; begin < count; begin += kBlockRecords) {
+        const size_t end = std::min(count, begin + kBlockRecords);
+        staging.resize((end - begin) * sizeof(PlyTriangle));
+        PlyTriangle* records = (PlyTriangle*)staging.data();
+        for (size_t t = begin; t < end; ++t)
+            records[t - begin] = { 3, { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] } };
+        file.write(staging.data(), (std::streamsize)staging.size());
+    }
+    appended += count;
+    return (bool)file;
+}
+
+bool PlyStreamWriter::Close(size_t* bytesWritten)
+{
+    file.flush();
+    const bool ok = (bool)file && appended == numTriangles;
+    file.close();
+    std::vector<char>().swap(staging);
+    if (!ok) {
+        std::cerr << "[MeshExport] Write failed: " << path << " (" << appended << "/" << numTriangles << " triangles)\n";
+        return false;
+    }
+    if (bytesWritten) *bytesWritten = triangleOffset + (uint64_t)numTriangles * sizeof(PlyTriangle);
+    return true;
+}
+
+bool writePly(const std::string& path, const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+    size_t* bytesWritten)
+{
+    PlyStreamWriter writer;
+    return writer.Open(path, verts.size(), indices.size() / 3)
+        && writer.WriteVertices(0, verts.data(), verts.size())
+        && writer.AppendTriangles(indices.data(), indices.size() / 3)
+        && writer.Close(bytesWritten);
+}
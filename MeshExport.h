@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Subdivision.h"
+
+// Writes a triangle list as binary little-endian PLY: float x y z nx ny nz s t per vertex and a
+// uchar/uint index list per face. bytesWritten (optional) receives the file size.
+bool writePly(const std::string& path, const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+    size_t* bytesWritten = nullptr);
+
+// Same PLY layout written in pieces, for meshes that never exist in memory at once. Open lays out
+// the header and a zero-filled vertex section sized from the final counts; vertices are then
+// written at their index in any order (a vertex written twice keeps the last value) and triangles
+// are appended in order behind the vertex section.
+class PlyStreamWriter {
+public:
+    bool Open(const std::string& path, size_t numVertices, size_t numTriangles);
+    bool WriteVertices(size_t first, const Vertex* verts, size_t count);
+    bool AppendTriangles(const unsigned int* indices, size_t numTriangles);
+    // Fails unless exactly the announced number of triangles was appended
+    bool Close(size_t* bytesWritten = nullptr);
+
+private:
+    std::fstream file;
+    std::string path;
+    size_t numVertices = 0;
+    size_t numTriangles = 0;
+    size_t appended = 0;
+    uint64_t vertexOffset = 0; // first byte of the vertex section
+    uint64_t triangleOffset = 0;
+    std::vector<char> staging;
+};
@@ -0,0 +1,72 @@
+#include "MeshPrimitives.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Normals.h"
+
+void createCube(std::shared_ptr<MeshData>& mesh) {
+    // Always a fresh mesh: the previous one may be shared with the resource cache
+    mesh = std::make_shared<MeshData>();
+
+    std::vector<glm::vec3> p = {
+        {-0.5f,-0.5f, 0.5f}, { 0.5f,-0.5f, 0.5f}, { 0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f},
+        {-0.5f,-0.5f,-0.5f}, { 0.5f,-0.5f,-0.5f}, { 0.5f, 0.5f,-0.5f}, {-0.5f, 0.5f,-0.5f}
+    };
+    std::vector<unsigned int> idx = {
+        0,1,2,3,  1,5,6,2,  5,4,7,6,  4,0,3,7,  3,2,6,7,  4,5,1,0
+    };
+    std::vector<int> vertsPerFace(6, 4);
+    std::vector<glm::vec3> normals(p.size(), glm::vec3(0,0,0));
+
+    std::vector<unsigned int> tris;
+    triangulateFaces(vertsPerFace.data(), vertsPerFace.size(), idx.data(), 0, tris);
+    VertexFaceAdjacency adjacency;
+    buildVertexFaceAdjacency(tris.data(), tris.size() / 3, p.size(), adjacency);
+    computeSmoothNormals(glm::value_ptr(p[0]), 3, p.size(), tris.data(), tris.size() / 3, adjacency, glm::value_ptr(normals[0]), 3);
+
+    mesh->uvs = std::vector<glm::vec2>(p.size(), glm::vec2(0,0));
+    mesh->vertsPerFace = std::move(vertsPerFace);
+    mesh->normals = std::move(normals);
+    mesh->vertices = std::move(p);
+    mesh->indices = std::move(idx);
+}
+
+void triangulateFaces(const int* vertsPerFace, size_t numFaces, const unsigned int* faceIndices,
+    unsigned int vertexOffset, std::vector<unsigned int>& triangles)
+{
+    size_t numTris = 0;
+    for (size_t f = 0; f < numFaces; ++f) numTris += vertsPerFace[f] >= 3 ? vertsPerFace[f] - 2 : 0;
+    triangles.reserve(triangles.size() + numTris * 3);
+
+    for (size_t f = 0; f < numFaces; ++f) {
+        const int n = vertsPerFace[f];
+        for (int k = 1; k + 1 < n; ++k) {
+            triangles.push_back(faceIndices[0] + vertexOffset);
+            triangles.push_back(faceIndices[k] + vertexOffset);
+            triangles.push_back(faceIndices[k + 1] + vertexOffset);
+        }
+        faceIndices += n;
+    }
+}
+
+bool isTriangleMesh(const MeshData& mesh)
+{
+    return std::all_of(mesh.vertsPerFace.begin(), mesh.vertsPerFace.end(), [](int n) { return n == 3; });
+}
+
+std::shared_ptr<MeshData> triangulateMesh(const MeshData& mesh)
+{
+    auto result = std::make_shared<MeshData>();
+    result->vertices = std::vector<glm::vec3>(mesh.vertices.begin(), mesh.vertices.end());
+    result->normals = std::vector<glm::vec3>(mesh.normals.begin(), mesh.normals.end());
+    result->uvs = std::vector<glm::vec2>(mesh.uvs.begin(), mesh.uvs.end());
+
+    std::vector<unsigned int> tris;
+    triangulateFaces(mesh.vertsPerFace.data(), mesh.vertsPerFace.size(), mesh.indices.data(), 0, tris);
+    result->vertsPerFace = std::vector<int>(tris.size() / 3, 3);
+    result->indices = std::move(tris);
+    return result;
+}
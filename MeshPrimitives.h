@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ResourceManager.h"
+
+// Testing cube: 8 vertices, 6 quads, smooth normals
+void createCube(std::shared_ptr<MeshData>& mesh);
+
+// Fan-splits faces into triangles (a quad becomes 0-1-2, 0-2-3) and appends them, offsetting each
+// index by vertexOffset. Faces with fewer than three corners are skipped.
+void triangulateFaces(const int* vertsPerFace, size_t numFaces, const unsigned int* faceIndices,
+    unsigned int vertexOffset, std::vector<unsigned int>& triangles);
+
+// True when every face of the cage is a triangle, i.e. Loop can refine it as is
+bool isTriangleMesh(const MeshData& mesh);
+
+// Copy of mesh with every face fan-split, for schemes that only take triangles
+std::shared_ptr<MeshData> triangulateMesh(const MeshData& mesh);
@@ -0,0 +1,221 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+#include <opensubdiv/far/primvarRefiner.h>
+
+#include "Parallel.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+// Below this many meshlets the bounds pass stays on the calling thread
+constexpr size_t kMinParallelMeshlets = 1024;
+
+void computeBounds(const std::vector<Vertex>& verts, const MeshletBuffers& buffers, Meshlet& m)
+{
+    const unsigned int* local = buffers.vertices.data() + m.vertexOffset;
+
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (uint32_t i = 0; i < m.vertexCount; ++i) {
+        lo = glm::min(lo, verts[local[i]].pos);
+        hi = glm::max(hi, verts[local[i]].pos);
+    }
+    m.center = (lo + hi) * 0.5f;
+    float radiusSq = 0.0f;
+    for (uint32_t i = 0; i < m.vertexCount; ++i) {
+        glm::vec3 d = verts[local[i]].pos - m.center;
+        radiusSq = std::max(radiusSq, glm::dot(d, d));
+    }
+    m.radius = std::sqrt(radiusSq);
+
+    // Cone around the mean unit face normal; its cutoff is the sine of the widest deviation
+    std::vector<glm::vec3> normals;
+    normals.reserve(m.triangleCount);
+    glm::vec3 sum(0.0f);
+    for (uint32_t t = 0; t < m.triangleCount; ++t) {
+        size_t base = ((size_t)m.triangleOffset + t) * 3;
+        const glm::vec3& p0 = verts[local[buffers.LocalIndex(base)]].pos;
+        const glm::vec3& p1 = verts[local[buffers.LocalIndex(base + 1)]].pos;
+        const glm::vec3& p2 = verts[local[buffers.LocalIndex(base + 2)]].pos;
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float len = glm::length(n);
+        if (len <= 1e-10f) continue;
+        normals.push_back(n / len);
+        sum += normals.back();
+    }
+
+    m.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    m.coneCutoff = 1.0f;
+    float sumLen = glm::length(sum);
+    if (normals.empty() || sumLen <= 1e-6f) return;
+
+    glm::vec3 axis = sum / sumLen;
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals) minDot = std::min(minDot, glm::dot(n, axis));
+    m.coneAxis = axis;
+    if (minDot > 0.0f) m.coneCutoff = std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+}
+
+}
+
+size_t MeshletBuffers::MemoryBytes() const
+{
+    return meshlets.capacity() * sizeof(Meshlet) + vertices.capacity() * sizeof(unsigned int)
+        + localIndices8.capacity() + localIndices16.capacity() * sizeof(uint16_t);
+}
+
+void buildBaseFaceGroups(const Far::TopologyRefiner& refiner, std::vector<unsigned int>& triangleGroups)
+{
+    triangleGroups.clear();
+    if (!refiner.IsUniform()) return;
+
+    // Each level's faces inherit the base face of their parent
+    std::vector<unsigned int> faceGroups((size_t)refiner.GetLevel(0).GetNumFaces());
+    std::iota(faceGroups.begin(), faceGroups.end(), 0u);
+    Far::PrimvarRefiner primvarRefiner(refiner);
+    for (int level = 1; level <= refiner.GetMaxLevel(); ++level) {
+        std::vector<unsigned int> childGroups((size_t)refiner.GetLevel(level).GetNumFaces());
+        const unsigned int* src = faceGroups.data();
+        unsigned int* dst = childGroups.data();
+        primvarRefiner.InterpolateFaceUniform(level, src, dst);
+        faceGroups.swap(childGroups);
+    }
+
+    // One entry per triangle of the fan split in extractTriangleIndices
+    const Far::TopologyLevel& lastLevel = refiner.GetLevel(refiner.GetMaxLevel());
+    triangleGroups.reserve((size_t)(lastLevel.GetNumFaceVertices() - 2 * lastLevel.GetNumFaces()));
+    for (int face = 0; face < lastLevel.GetNumFaces(); ++face) {
+        const int numTris = lastLevel.GetFaceVertices(face).size() - 2;
+        for (int t = 0; t < numTris; ++t) triangleGroups.push_back(faceGroups[face]);
+    }
+}
+
+bool buildMeshlets(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+    const std::vector<unsigned int>& triangleGroups, const MeshletOptions& options, MeshletBuffers& out,
+    unsigned int numThreads)
+{
+    out = MeshletBuffers();
+    if (options.maxVertices < 3 || options.maxVertices > 65536 || options.maxTriangles == 0) {
+        std::cerr << "[Meshlets] Error: need 3 <= maxVertices <= 65536 and maxTriangles > 0\n";
+        return false;
+    }
+    const size_t numTris = indices.size() / 3;
+    const size_t numVerts = verts.size();
+    if (!triangleGroups.empty() && triangleGroups.size() != numTris) {
+        std::cerr << "[Meshlets] Error: " << triangleGroups.size() << " triangle groups for " << numTris << " triangles\n";
+        return false;
+    }
+    for (size_t i = 0; i < numTris * 3; ++i) {
+        if (indices[i] >= numVerts) {
+            std::cerr << "[Meshlets] Error: index " << indices[i] << " out of range\n";
+            return false;
+        }
+    }
+    out.wideIndices = options.maxVertices > 256;
+    if (numTris == 0) return true;
+
+    // Stable counting sort of triangles by group; without groups each triangle is its own group
+    std::vector<uint32_t> order(numTris);
+    std::vector<uint32_t> groupStart;
+    if (triangleGroups.empty()) {
+        std::iota(order.begin(), order.end(), 0u);
+        groupStart.resize(numTris + 1);
+        std::iota(groupStart.begin(), groupStart.end(), 0u);
+    }
+    else {
+        const size_t numGroups = (size_t)*std::max_element(triangleGroups.begin(), triangleGroups.end()) + 1;
+        groupStart.assign(numGroups + 1, 0);
+        for (unsigned int g : triangleGroups) groupStart[g + 1]++;
+        for (size_t g = 0; g < numGroups; ++g) groupStart[g + 1] += groupStart[g];
+        std::vector<uint32_t> cursor(groupStart.begin(), groupStart.end() - 1);
+        for (size_t t = 0; t < numTris; ++t) order[cursor[triangleGroups[t]]++] = (uint32_t)t;
+    }
+
+    // localOf[v] is valid while stamp[v] equals the meshlet being filled
+    std::vector<uint32_t> stamp(numVerts, kNone), localOf(numVerts, 0);
+    std::vector<uint32_t> groupStamp(numVerts, kNone);
+    out.meshlets.reserve(numTris / std::min<size_t>(options.maxTriangles, 64) + 1);
+    out.vertices.reserve(numTris);
+    if (out.wideIndices) out.localIndices16.reserve(numTris * 3);
+    else out.localIndices8.reserve(numTris * 3);
+
+    Meshlet current;
+    uint32_t currentId = 0;
+    auto flush = [&]() {
+        if (current.triangleCount == 0) return;
+        out.meshlets.push_back(current);
+        currentId++;
+        current = Meshlet();
+        current.vertexOffset = (uint32_t)out.vertices.size();
+        current.triangleOffset = (uint32_t)(out.NumLocalIndices() / 3);
+    };
+    auto newVertices = [&](const unsigned int* tri) {
+        uint32_t count = 0;
+        for (int c = 0; c < 3; ++c) {
+            bool seen = stamp[tri[c]] == currentId || (c > 0 && tri[c] == tri[0]) || (c > 1 && tri[c] == tri[1]);
+            if (!seen) count++;
+        }
+        return count;
+    };
+
+    for (size_t g = 0; g + 1 < groupStart.size(); ++g) {
+        const uint32_t begin = groupStart[g], end = groupStart[g + 1];
+        if (begin == end) continue;
+
+        // Start a fresh meshlet when a group that fits on its own would not fit in the current one
+        if (current.triangleCount > 0 && end - begin <= options.maxTriangles) {
+            bool fits = current.triangleCount + (end - begin) <= options.maxTriangles;
+            uint32_t added = 0;
+            for (uint32_t i = begin; fits && i < end; ++i) {
+                const unsigned int* tri = &indices[(size_t)order[i] * 3];
+                for (int c = 0; c < 3; ++c) {
+                    unsigned int v = tri[c];
+                    if (stamp[v] == currentId || groupStamp[v] == (uint32_t)g) continue;
+                    groupStamp[v] = (uint32_t)g;
+                    added++;
+                }
+                fits = current.vertexCount + added <= options.maxVertices;
+            }
+            if (!fits) flush();
+        }
+
+        for (uint32_t i = begin; i < end; ++i) {
+            const unsigned int* tri = &indices[(size_t)order[i] * 3];
+            if (current.triangleCount + 1 > options.maxTriangles || current.vertexCount + newVertices(tri) > options.maxVertices)
+                flush();
+            if (current.triangleCount == 0) current.group = triangleGroups.empty() ? order[i] : (uint32_t)g;
+
+            for (int c = 0; c < 3; ++c) {
+                unsigned int v = tri[c];
+                if (stamp[v] != currentId) {
+                    stamp[v] = currentId;
+                    localOf[v] = current.vertexCount++;
+                    out.vertices.push_back(v);
+                }
+                if (out.wideIndices) out.localIndices16.push_back((uint16_t)localOf[v]);
+                else out.localIndices8.push_back((uint8_t)localOf[v]);
+            }
+            current.triangleCount++;
+        }
+    }
+    flush();
+
+    parallelFor(0, out.meshlets.size(), [&](size_t begin, size_t end) {
+        for (size_t m = begin; m < end; ++m) computeBounds(verts, out, out.meshlets[m]);
+    }, out.meshlets.size() < kMinParallelMeshlets ? 1 : numThreads);
+    return true;
+}
+
+bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPos)
+{
+    glm::vec3 toCenter = meshlet.center - cameraPos;
+    return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include "Subdivision.h"
+
+struct MeshletOptions {
+    unsigned int maxVertices = 64;   // <= 256 selects 8-bit local indices, otherwise 16-bit (max 65536)
+    unsigned int maxTriangles = 124;
+};
+
+// One cluster: its vertices are vertices[vertexOffset .. +vertexCount) (global ids) and its
+// triangles are local index triples starting at triangleOffset * 3 in the local index buffer
+struct Meshlet {
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t triangleOffset = 0;
+    uint32_t triangleCount = 0;
+    uint32_t group = 0;          // first triangle group (e.g. base face) packed into it
+
+    glm::vec3 center = glm::vec3(0.0f); // bounding sphere
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f); // normal cone; cutoff 1 never culls
+    float coneCutoff = 1.0f;
+};
+
+struct MeshletBuffers {
+    std::vector<Meshlet> meshlets;
+    std::vector<unsigned int> vertices;  // local -> global vertex id, per meshlet
+    bool wideIndices = false;            // which of the two local index buffers is filled
+    std::vector<uint8_t> localIndices8;
+    std::vector<uint16_t> localIndices16;
+
+    size_t NumLocalIndices() const { return wideIndices ? localIndices16.size() : localIndices8.size(); }
+    uint32_t LocalIndex(size_t i) const { return wideIndices ? localIndices16[i] : localIndices8[i]; }
+    size_t MemoryBytes() const;
+};
+
+// Base-cage face each last-level triangle descends from, in extractTriangleIndices order
+// (one entry per triangular face), so children of one coarse face can be kept together
+void buildBaseFaceGroups(const OpenSubdiv::Far::TopologyRefiner& refiner, std::vector<unsigned int>& triangleGroups);
+
+// Packs triangles into meshlets of at most maxVertices / maxTriangles. Triangles are visited
+// group by group (groups may be empty for one group per triangle order); a group that fits is
+// never split across meshlets, larger groups are split in their original order, which for a
+// uniform refinement keeps each meshlet inside one coarse face. Bounds are computed in parallel.
+bool buildMeshlets(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+    const std::vector<unsigned int>& triangleGroups, const MeshletOptions& options, MeshletBuffers& out,
+    unsigned int numThreads = 0);
+
+// Cone test against a camera position: true when every triangle of the meshlet faces away
+bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPos);
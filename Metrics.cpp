@@ -0,0 +1,49 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+SampleSummary summarizeSamples(std::vector<double> samples)
+{
+    SampleSummary s;
+    s.count = samples.size();
+    if (samples.empty()) return s;
+
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](double q) {
+        size_t r = (size_t)std::ceil(q * (double)samples.size());
+        return samples[std::min(samples.size() - 1, r > 0 ? r - 1 : 0)];
+    };
+    s.min = samples.front();
+    s.median = rank(0.5);
+    s.p99 = rank(0.99);
+    return s;
+}
+
+uint64_t peakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (uint64_t)counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;        // bytes on macOS
+#else
+    return (uint64_t)usage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+#endif
+}
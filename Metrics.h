@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Stopwatch {
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+    void Reset() { start = std::chrono::steady_clock::now(); }
+    double ElapsedMs() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+struct SampleSummary {
+    double min = 0.0;
+    double median = 0.0;
+    double p99 = 0.0;
+    size_t count = 0;
+};
+
+// Nearest-rank percentiles over a copy of samples
+SampleSummary summarizeSamples(std::vector<double> samples);
+
+// Peak resident set size of this process in bytes, 0 if unavailable
+uint64_t peakResidentBytes();
@@ -0,0 +1,265 @@
+#include "Normals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NORMALS_USE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NORMALS_USE_SSE 1
+#endif
+
+#include "Parallel.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+// Below this many elements the thread hand-off costs more than the work
+constexpr size_t kMinParallelElements = 16384;
+
+// Matches the old scatter loop: faces with |n| <= 1e-10 contribute nothing
+constexpr float kDegenerateLengthSq = 1e-20f;
+
+unsigned int threadsFor(size_t count, unsigned int numThreads)
+{
+    if (count < kMinParallelElements) return 1;
+    return numThreads;
+}
+
+void faceNormalsScalar(const float* positions, size_t stride, size_t numVerts, const unsigned int* tri,
+    size_t begin, size_t end, float* nx, float* ny, float* nz)
+{
+    for (size_t t = begin; t < end; ++t) {
+        unsigned int i0 = tri[t * 3], i1 = tri[t * 3 + 1], i2 = tri[t * 3 + 2];
+        if (i0 >= numVerts || i1 >= numVerts || i2 >= numVerts) {
+            nx[t] = ny[t] = nz[t] = 0.0f;
+            continue;
+        }
+        const float* p0 = positions + i0 * stride;
+        const float* p1 = positions + i1 * stride;
+        const float* p2 = positions + i2 * stride;
+
+        float e1x = p1[0] - p0[0], e1y = p1[1] - p0[1], e1z = p1[2] - p0[2];
+        float e2x = p2[0] - p0[0], e2y = p2[1] - p0[1], e2z = p2[2] - p0[2];
+        float cx = e1y * e2z - e1z * e2y;
+        float cy = e1z * e2x - e1x * e2z;
+        float cz = e1x * e2y - e1y * e2x;
+
+        if (cx * cx + cy * cy + cz * cz <= kDegenerateLengthSq) cx = cy = cz = 0.0f;
+        nx[t] = cx;
+        ny[t] = cy;
+        nz[t] = cz;
+    }
+}
+
+#if defined(NORMALS_USE_AVX2)
+constexpr size_t kLanes = 8;
+
+void faceNormalsSimd(const float* positions, size_t stride, size_t numVerts, const unsigned int* tri,
+    size_t begin, size_t end, float* nx, float* ny, float* nz)
+{
+    // 32-bit gather offsets; huge buffers take the scalar path
+    if (numVerts * stride >= (size_t)INT32_MAX) {
+        faceNormalsScalar(positions, stride, numVerts, tri, begin, end, nx, ny, nz);
+        return;
+    }
+
+    const __m256 eps = _mm256_set1_ps(kDegenerateLengthSq);
+    size_t t = begin;
+    for (; t + kLanes <= end; t += kLanes) {
+        alignas(32) int32_t o0[kLanes], o1[kLanes], o2[kLanes];
+        unsigned int maxIndex = 0;
+        for (size_t k = 0; k < kLanes; ++k) {
+            const unsigned int* f = tri + (t + k) * 3;
+            maxIndex = std::max(maxIndex, std::max(f[0], std::max(f[1], f[2])));
+            o0[k] = (int32_t)(f[0] * stride);
+            o1[k] = (int32_t)(f[1] * stride);
+            o2[k] = (int32_t)(f[2] * stride);
+        }
+        if (maxIndex >= numVerts) {
+            faceNormalsScalar(positions, stride, numVerts, tri, t, t + kLanes, nx, ny, nz);
+            continue;
+        }
+        __m256i v0 = _mm256_load_si256((const __m256i*)o0);
+        __m256i v1 = _mm256_load_si256((const __m256i*)o1);
+        __m256i v2 = _mm256_load_si256((const __m256i*)o2);
+
+        __m256 p0x = _mm256_i32gather_ps(positions, v0, 4);
+        __m256 p0y = _mm256_i32gather_ps(positions + 1, v0, 4);
+        __m256 p0z = _mm256_i32gather_ps(positions + 2, v0, 4);
+        __m256 e1x = _mm256_sub_ps(_mm256_i32gather_ps(positions, v1, 4), p0x);
+        __m256 e1y = _mm256_sub_ps(_mm256_i32gather_ps(positions + 1, v1, 4), p0y);
+        __m256 e1z = _mm256_sub_ps(_mm256_i32gather_ps(positions + 2, v1, 4), p0z);
+        __m256 e2x = _mm256_sub_ps(_mm256_i32gather_ps(positions, v2, 4), p0x);
+        __m256 e2y = _mm256_sub_ps(_mm256_i32gather_ps(positions + 1, v2, 4), p0y);
+        __m256 e2z = _mm256_sub_ps(_mm256_i32gather_ps(positions + 2, v2, 4), p0z);
+
+        __m256 cx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e1z, e2y));
+        __m256 cy = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e1x, e2z));
+        __m256 cz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e1y, e2x));
+
+        __m256 lenSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+        __m256 keep = _mm256_cmp_ps(lenSq, eps, _CMP_GT_OQ);
+        _mm256_storeu_ps(nx + t, _mm256_and_ps(cx, keep));
+        _mm256_storeu_ps(ny + t, _mm256_and_ps(cy, keep));
+        _mm256_storeu_ps(nz + t, _mm256_and_ps(cz, keep));
+    }
+    faceNormalsScalar(positions, stride, numVerts, tri, t, end, nx, ny, nz);
+}
+#elif defined(NORMALS_USE_SSE)
+constexpr size_t kLanes = 4;
+
+void faceNormalsSimd(const float* positions, size_t stride, size_t numVerts, const unsigned int* tri,
+    size_t begin, size_t end, float* nx, float* ny, float* nz)
+{
+    const __m128 eps = _mm_set1_ps(kDegenerateLengthSq);
+    size_t t = begin;
+    for (; t + kLanes <= end; t += kLanes) {
+        const float* p[3][kLanes];
+        unsigned int maxIndex = 0;
+        for (size_t k = 0; k < kLanes; ++k) {
+            const unsigned int* f = tri + (t + k) * 3;
+            maxIndex = std::max(maxIndex, std::max(f[0], std::max(f[1], f[2])));
+            p[0][k] = positions + f[0] * stride;
+            p[1][k] = positions + f[1] * stride;
+            p[2][k] = positions + f[2] * stride;
+        }
+        if (maxIndex >= numVerts) {
+            faceNormalsScalar(positions, stride, numVerts, tri, t, t + kLanes, nx, ny, nz);
+            continue;
+        }
+
+        // No gather before AVX2: transpose four corners per component by hand
+        __m128 c[3][3];
+        for (int corner = 0; corner < 3; ++corner)
+            for (int axis = 0; axis < 3; ++axis)
+                c[corner][axis] = _mm_set_ps(p[corner][3][axis], p[corner][2][axis], p[corner][1][axis], p[corner][0][axis]);
+
+        __m128 e1x = _mm_sub_ps(c[1][0], c[0][0]), e1y = _mm_sub_ps(c[1][1], c[0][1]), e1z = _mm_sub_ps(c[1][2], c[0][2]);
+        __m128 e2x = _mm_sub_ps(c[2][0], c[0][0]), e2y = _mm_sub_ps(c[2][1], c[0][1]), e2z = _mm_sub_ps(c[2][2], c[0][2]);
+
+        __m128 cx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+        __m128 cy = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+        __m128 cz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+        __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+        __m128 keep = _mm_cmpgt_ps(lenSq, eps);
+        _mm_storeu_ps(nx + t, _mm_and_ps(cx, keep));
+        _mm_storeu_ps(ny + t, _mm_and_ps(cy, keep));
+        _mm_storeu_ps(nz + t, _mm_and_ps(cz, keep));
+    }
+    faceNormalsScalar(positions, stride, numVerts, tri, t, end, nx, ny, nz);
+}
+#else
+void faceNormalsSimd(const float* positions, size_t stride, size_t numVerts, const unsigned int* tri,
+    size_t begin, size_t end, float* nx, float* ny, float* nz)
+{
+    faceNormalsScalar(positions, stride, numVerts, tri, begin, end, nx, ny, nz);
+}
+#endif
+
+}
+
+void buildVertexFaceAdjacency(const unsigned int* triIndices, size_t numTris, size_t numVerts, VertexFaceAdjacency& adjacency)
+{
+    adjacency.offsets.assign(numVerts + 1, 0);
+    for (size_t i = 0; i < numTris * 3; ++i)
+        if (triIndices[i] < numVerts) ++adjacency.offsets[triIndices[i] + 1];
+
+    for (size_t v = 0; v < numVerts; ++v)
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+    adjacency.faces.resize(adjacency.offsets[numVerts]);
+    std::vector<unsigned int> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (size_t t = 0; t < numTris; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = triIndices[t * 3 + k];
+            if (v < numVerts) adjacency.faces[cursor[v]++] = (unsigned int)t;
+        }
+    }
+}
+
+bool buildVertexFaceAdjacency(const Far::TopologyLevel& level, VertexFaceAdjacency& adjacency)
+{
+    const int numVerts = level.GetNumVertices();
+    if (level.GetNumFaceVertices() != level.GetNumFaces() * 3) return false;
+
+    adjacency.offsets.resize((size_t)numVerts + 1);
+    adjacency.offsets[0] = 0;
+    for (int v = 0; v < numVerts; ++v)
+        adjacency.offsets[v + 1] = adjacency.offsets[v] + (unsigned int)level.GetVertexFaces(v).size();
+
+    adjacency.faces.resize(adjacency.offsets[numVerts]);
+    parallelFor(0, (size_t)numVerts, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            Far::ConstIndexArray faces = level.GetVertexFaces((Far::Index)v);
+            unsigned int* dst = adjacency.faces.data() + adjacency.offsets[v];
+            for (int i = 0; i < faces.size(); ++i) dst[i] = (unsigned int)faces[i];
+        }
+    }, threadsFor((size_t)numVerts, 0));
+    return true;
+}
+
+void computeFaceNormals(const float* positions, size_t positionStride, size_t numVerts,
+    const unsigned int* triIndices, size_t numTris, FaceNormalsSoA& faceNormals, unsigned int numThreads)
+{
+    faceNormals.x.resize(numTris);
+    faceNormals.y.resize(numTris);
+    faceNormals.z.resize(numTris);
+    float* nx = faceNormals.x.data();
+    float* ny = faceNormals.y.data();
+    float* nz = faceNormals.z.data();
+
+    parallelFor(0, numTris, [&](size_t begin, size_t end) {
+        faceNormalsSimd(positions, positionStride, numVerts, triIndices, begin, end, nx, ny, nz);
+    }, threadsFor(numTris, numThreads));
+}
+
+void gatherVertexNormals(const VertexFaceAdjacency& adjacency, const FaceNormalsSoA& faceNormals,
+    float* normals, size_t normalStride, unsigned int numThreads)
+{
+    const size_t numVerts = adjacency.NumVertices();
+    const unsigned int* offsets = adjacency.offsets.data();
+    const unsigned int* faces = adjacency.faces.data();
+    const float* nx = faceNormals.x.data();
+    const float* ny = faceNormals.y.data();
+    const float* nz = faceNormals.z.data();
+
+    parallelFor(0, numVerts, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+            for (unsigned int i = offsets[v]; i < offsets[v + 1]; ++i) {
+                unsigned int f = faces[i];
+                sx += nx[f];
+                sy += ny[f];
+                sz += nz[f];
+            }
+            float* n = normals + v * normalStride;
+            float len = std::sqrt(sx * sx + sy * sy + sz * sz);
+            if (len > 1e-10f) {
+                float inv = 1.0f / len;
+                n[0] = sx * inv;
+                n[1] = sy * inv;
+                n[2] = sz * inv;
+            }
+            else {
+                n[0] = 0.0f;
+                n[1] = 1.0f;
+                n[2] = 0.0f;
+            }
+        }
+    }, threadsFor(numVerts, numThreads));
+}
+
+void computeSmoothNormals(const float* positions, size_t positionStride, size_t numVerts,
+    const unsigned int* triIndices, size_t numTris, const VertexFaceAdjacency& adjacency,
+    float* normals, size_t normalStride, unsigned int numThreads)
+{
+    FaceNormalsSoA faceNormals;
+    computeFaceNormals(positions, positionStride, numVerts, triIndices, numTris, faceNormals, numThreads);
+    gatherVertexNormals(adjacency, faceNormals, normals, normalStride, numThreads);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opensubdiv/far/topologyLevel.h>
+
+// Vertex -> incident triangles in CSR form: faces[offsets[v] .. offsets[v + 1]) touch vertex v
+struct VertexFaceAdjacency {
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> faces;
+    size_t NumVertices() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+// Face normals in structure-of-arrays layout so they can be written by SIMD lanes
+struct FaceNormalsSoA {
+    std::vector<float> x, y, z;
+};
+
+// Counting sort over a triangle list; faces are listed in ascending triangle order
+void buildVertexFaceAdjacency(const unsigned int* triIndices, size_t numTris, size_t numVerts, VertexFaceAdjacency& adjacency);
+
+// Uses the level's vertex-face relation (requires full topology in that level). Returns false
+// if the level holds non-triangular faces, since face ids would no longer match triangle ids.
+bool buildVertexFaceAdjacency(const OpenSubdiv::Far::TopologyLevel& level, VertexFaceAdjacency& adjacency);
+
+// Positions and normals are strided float arrays (stride in floats), so the same kernels serve
+// Vertex (pos/normal inside a 32-byte record) and MeshData (packed glm::vec3) storage.
+
+// Area-weighted triangle normals; degenerate triangles get a zero normal.
+// Uses AVX2 or SSE when the build enables them, scalar code otherwise.
+void computeFaceNormals(const float* positions, size_t positionStride, size_t numVerts,
+    const unsigned int* triIndices, size_t numTris, FaceNormalsSoA& faceNormals, unsigned int numThreads = 0);
+
+// Each vertex sums its own incident faces, so threads never write the same vertex and no atomics are needed
+void gatherVertexNormals(const VertexFaceAdjacency& adjacency, const FaceNormalsSoA& faceNormals,
+    float* normals, size_t normalStride, unsigned int numThreads = 0);
+
+// computeFaceNormals followed by gatherVertexNormals
+void computeSmoothNormals(const float* positions, size_t positionStride, size_t numVerts,
+    const unsigned int* triIndices, size_t numTris, const VertexFaceAdjacency& adjacency,
+    float* normals, size_t normalStride, unsigned int numThreads = 0);
@@ -0,0 +1,198 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+
+#include "MappedFile.h"
+#include "Parallel.h"
+
+namespace {
+
+// Smaller chunks are not worth a task of their own
+constexpr size_t kMinChunkBytes = 256 * 1024;
+
+// Corner indices are limited to kMaxIndex in magnitude, so relative references stored around
+// kRelative can never be mistaken for absolute ones, even when they reach back past the chunk start
+constexpr int64_t kMaxIndex = int64_t(1) << 40;
+constexpr int64_t kRelative = int64_t(1) << 62;
+
+struct ChunkResult {
+    std::vector<glm::vec3> positions;
+    // Position index per face corner: below kRelative - kMaxIndex it is absolute (0-based), otherwise
+    // kRelative + chunk-local position count + relative index, resolved once the chunk's base is known
+    std::vector<int64_t> corners;
+    std::vector<int> faceSizes;
+    size_t texcoords = 0;
+    size_t normals = 0;
+    size_t errorLine = 0; // 1-based line within the chunk, 0: no error
+};
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+inline const char* skipToken(const char* p, const char* end)
+{
+    while (p < end && !isBlank(*p)) ++p;
+    return p;
+}
+
+inline bool parseFloat(const char*& p, const char* end, float& value)
+{
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') ++p; // from_chars rejects an explicit plus sign
+    auto [next, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) return false;
+    p = next;
+    return true;
+}
+
+// One face corner "v", "v/t", "v//n" or "v/t/n"; only the position index is kept
+inline bool parseCorner(const char*& p, const char* end, int64_t& index)
+{
+    if (p < end && *p == '+') ++p;
+    auto [next, ec] = std::from_chars(p, end, index);
+    if (ec != std::errc() || index == 0 || index > kMaxIndex || index < -kMaxIndex) return false;
+    p = skipToken(next, end);
+    return true;
+}
+
+void parseChunk(const char* begin, const char* end, ChunkResult& out)
+{
+    std::vector<int64_t> face;
+    size_t line = 0;
+    for (const char* p = begin; p < end;) {
+        const char* lineEnd = std::find(p, end, '\n');
+        ++line;
+        const char* s = skipBlanks(p, lineEnd);
+        p = lineEnd + 1;
+        if (s + 1 >= lineEnd) continue;
+
+        if (s[0] == 'v' && isBlank(s[1])) {
+            glm::vec3 v;
+            const char* q = s + 1;
+            if (!parseFloat(q, lineEnd, v.x) || !parseFloat(q, lineEnd, v.y) || !parseFloat(q, lineEnd, v.z)) {
+                out.errorLine = line;
+                return;
+            }
+            out.positions.push_back(v);
+        }
+        else if (s[0] == 'v' && s[1] == 't' && (s + 2 == lineEnd || isBlank(s[2]))) {
+            out.texcoords++;
+        }
+        else if (s[0] == 'v' && s[1] == 'n' && (s + 2 == lineEnd || isBlank(s[2]))) {
+            out.normals++;
+        }
+        else if (s[0] == 'f' && isBlank(s[1])) {
+            face.clear();
+            for (const char* q = skipBlanks(s + 1, lineEnd); q < lineEnd; q = skipBlanks(q, lineEnd)) {
+                int64_t index;
+                if (!parseCorner(q, lineEnd, index)) {
+                    out.errorLine = line;
+                    return;
+                }
+                face.push_back(index > 0 ? index - 1 : kRelative + (int64_t)out.positions.size() + index);
+            }
+            if (face.size() < 3) continue;
+            out.faceSizes.push_back((int)face.size());
+            out.corners.insert(out.corners.end(), face.begin(), face.end());
+        }
+    }
+}
+
+}
+
+bool parseObjCorners(const char* text, size_t size, std::vector<glm::vec3>& corners, std::vector<int>& faceSizes,
+    ObjParseStats* stats, unsigned int numThreads, size_t chunkBytes)
+{
+    corners.clear();
+    faceSizes.clear();
+    if (numThreads == 0) numThreads = defaultThreadCount();
+    if (chunkBytes == 0) chunkBytes = kMinChunkBytes;
+
+    // Line-aligned chunk boundaries
+    const size_t numChunks = std::clamp<size_t>(size / chunkBytes, 1, (size_t)numThreads * 4);
+    std::vector<size_t> bounds(numChunks + 1, size);
+    bounds[0] = 0;
+    for (size_t c = 1; c < numChunks; ++c) {
+        size_t b = std::max(bounds[c - 1], size * c / numChunks);
+        while (b < size && b > 0 && text[b - 1] != '\n') ++b;
+        bounds[c] = b;
+    }
+
+    std::vector<ChunkResult> chunks(numChunks);
+    parallelFor(0, numChunks, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c) parseChunk(text + bounds[c], text + bounds[c + 1], chunks[c]);
+    }, numChunks == 1 ? 1 : numThreads);
+
+    // Prefix sums give every chunk its first position, corner and face
+    std::vector<size_t> positionBase(numChunks + 1, 0), cornerBase(numChunks + 1, 0), faceBase(numChunks + 1, 0);
+    for (size_t c = 0; c < numChunks; ++c) {
+        if (chunks[c].errorLine) {
+            size_t linesBefore = std::count(text, text + bounds[c], '\n');
+            std::cerr << "[ObjParser] Error: malformed record on line " << linesBefore + chunks[c].errorLine << "\n";
+            return false;
+        }
+        positionBase[c + 1] = positionBase[c] + chunks[c].positions.size();
+        cornerBase[c + 1] = cornerBase[c] + chunks[c].corners.size();
+        faceBase[c + 1] = faceBase[c] + chunks[c].faceSizes.size();
+    }
+    const size_t numPositions = positionBase[numChunks];
+
+    corners.resize(cornerBase[numChunks]);
+    faceSizes.resize(faceBase[numChunks]);
+    std::atomic<bool> inRange{ true };
+    parallelFor(0, numChunks, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c) {
+            const ChunkResult& chunk = chunks[c];
+            std::copy(chunk.faceSizes.begin(), chunk.faceSizes.end(), faceSizes.begin() + faceBase[c]);
+            for (size_t i = 0; i < chunk.corners.size(); ++i) {
+                int64_t index = chunk.corners[i];
+                int64_t absolute = index < kRelative - kMaxIndex ? index : (int64_t)positionBase[c] + (index - kRelative);
+                if (absolute < 0 || (size_t)absolute >= numPositions) {
+                    inRange = false;
+                    return;
+                }
+                size_t owner = std::upper_bound(positionBase.begin(), positionBase.end(), (size_t)absolute) - positionBase.begin() - 1;
+                corners[cornerBase[c] + i] = chunks[owner].positions[absolute - positionBase[owner]];
+            }
+        }
+    }, numChunks == 1 ? 1 : numThreads);
+    if (!inRange) {
+        std::cerr << "[ObjParser] Error: face index out of range (" << numPositions << " positions)\n";
+        corners.clear();
+        faceSizes.clear();
+        return false;
+    }
+
+    if (stats) {
+        *stats = ObjParseStats();
+        stats->positions = numPositions;
+        stats->chunks = numChunks;
+        stats->faces = faceSizes.size();
+        stats->triangles = corners.size() - 2 * faceSizes.size();
+        for (const ChunkResult& chunk : chunks) {
+            stats->texcoords += chunk.texcoords;
+            stats->normals += chunk.normals;
+        }
+    }
+    return true;
+}
+
+bool loadObjCorners(const std::filesystem::path& path, std::vector<glm::vec3>& corners, std::vector<int>& faceSizes,
+    ObjParseStats* stats, unsigned int numThreads)
+{
+    std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+    if (!file) {
+        std::cerr << "[ObjParser] Error: cannot map " << path << "\n";
+        return false;
+    }
+    return parseObjCorners((const char*)file->Data(), file->Size(), corners, faceSizes, stats, numThreads);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct ObjParseStats {
+    size_t positions = 0; // v
+    size_t texcoords = 0; // vt
+    size_t normals = 0;   // vn
+    size_t faces = 0;     // f with at least three corners
+    size_t triangles = 0; // after a fan split of every face
+    size_t chunks = 0;
+};
+
+// Parses OBJ text into face corner positions plus the corner count of each face, the same input
+// the Assimp path hands to the welder: polygons keep their arity and each corner is its position.
+// vt/vn records are counted only, since meshes get recomputed normals and no UVs. Relative
+// (negative) indices are supported; any other statement is skipped. The text is split into
+// line-aligned chunks (at least chunkBytes each, 0: 256 KB) parsed in parallel, and the output does
+// not depend on the chunking. Returns false on malformed v/f records or out-of-range indices,
+// including relative ones that reach before the first position.
+bool parseObjCorners(const char* text, size_t size, std::vector<glm::vec3>& corners, std::vector<int>& faceSizes,
+    ObjParseStats* stats = nullptr, unsigned int numThreads = 0, size_t chunkBytes = 0);
+
+// Maps the file and runs parseObjCorners over it
+bool loadObjCorners(const std::filesystem::path& path, std::vector<glm::vec3>& corners, std::vector<int>& faceSizes,
+    ObjParseStats* stats = nullptr, unsigned int numThreads = 0);
@@ -0,0 +1,346 @@
+#include "OutOfCoreExport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <opensubdiv/far/primvarRefiner.h>
+
+#include "MeshExport.h"
+#include "MeshPrimitives.h"
+#include "StreamingSubdivision.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+// Varying primvar recording which base vertices a refined vertex is blended from. Varying weights
+// never leave the parent face, so one contributor is a base vertex, two are the ends of a base edge
+// (weights k / 2^level, exact in float) and more mean the point lies inside a base face.
+struct Origin {
+    int vertices[2];
+    float weights[2];
+    int count; // 3: more than two contributors
+
+    void Clear(void* = 0) { count = 0; }
+    void AddWithWeight(const Origin& src, float weight)
+    {
+        if (weight == 0.0f || count > 2) return;
+        if (src.count > 2) {
+            count = 3;
+            return;
+        }
+        for (int i = 0; i < src.count; ++i) Add(src.vertices[i], src.weights[i] * weight);
+    }
+    void Add(int vertex, float weight)
+    {
+        if (weight == 0.0f || count > 2) return;
+        for (int i = 0; i < count; ++i) {
+            if (vertices[i] == vertex) {
+                weights[i] += weight;
+                return;
+            }
+        }
+        if (count == 2) {
+            count = 3;
+            return;
+        }
+        vertices[count] = vertex;
+        weights[count] = weight;
+        ++count;
+    }
+};
+
+// Faces of level that descend from one base face with n corners (children of a face stay contiguous
+// and in parent order under uniform refinement)
+size_t childFacesPerBaseFace(Sdc::SchemeType scheme, int n, int level)
+{
+    if (level <= 0) return 1;
+    return scheme == Sdc::SCHEME_LOOP ? (size_t)1 << (2 * level) : (size_t)n << (2 * (level - 1));
+}
+
+// Refined vertices strictly inside one base face with n corners
+size_t interiorVerticesPerBaseFace(Sdc::SchemeType scheme, int n, int level)
+{
+    if (level <= 0) return 0;
+    if (scheme == Sdc::SCHEME_LOOP) {
+        const size_t m = (size_t)1 << level; // segments per edge
+        return (m - 1) * (m - 2) / 2;
+    }
+    // Face point, the spokes to the edge midpoints and the inside of the n sub-quads
+    const size_t m = (size_t)1 << (level - 1);
+    return 1 + (size_t)n * (m - 1) * m;
+}
+
+// Grows groups of about facesPerGroup base faces across shared edges, in face order, so a group is
+// compact and its one-ring small relative to it
+std::vector<std::vector<int>> groupFaces(const Far::TopologyLevel& base, size_t facesPerGroup)
+{
+    const int numFaces = base.GetNumFaces();
+    std::vector<char> assigned(numFaces, 0);
+    std::vector<std::vector<int>> groups;
+    for (int seed = 0; seed < numFaces; ++seed) {
+        if (assigned[seed]) continue;
+        std::vector<int> group{ seed };
+        assigned[seed] = 1;
+        for (size_t head = 0; head < group.size() && group.size() < facesPerGroup; ++head) {
+            for (Far::Index e : base.GetFaceEdges(group[head])) {
+                for (Far::Index f : base.GetEdgeFaces(e)) {
+                    if (assigned[f] || group.size() >= facesPerGroup) continue;
+                    assigned[f] = 1;
+                    group.push_back(f);
+                }
+            }
+        }
+        groups.push_back(std::move(group));
+    }
+    return groups;
+}
+
+} // namespace
+
+size_t estimateOutOfCoreExportBytes(const Far::TopologyLevel& base, Sdc::SchemeType scheme, int level,
+    const OutOfCoreExportOptions& options)
+{
+    // Base topology and the per-vertex/per-face tables kept for the whole run
+    const size_t baseBytes = estimateTopologyLevelBytes(base) + (size_t)base.GetNumVertices() * 2 * sizeof(int)
+        + (size_t)base.GetNumFaces() * (sizeof(size_t) + 1);
+
+    // One tile: the streaming peak for the whole cage scaled down to a group and its one-ring (about
+    // three times the group's faces), plus the coarser levels a full refiner keeps (a third more)
+    const size_t numFaces = std::max(1, base.GetNumFaces());
+    const size_t facesPerGroup = std::max<size_t>(1, options.tileTriangles >> (2 * std::max(0, level)));
+    const double tileFraction = std::min(1.0, 3.0 * (double)facesPerGroup / (double)numFaces);
+    const double tileBytes = (double)estimateStreamingPeakBytes(base, scheme, level) * tileFraction * 4.0 / 3.0;
+    return baseBytes + (size_t)tileBytes;
+}
+
+bool exportSubdividedPly(const MeshData& mesh, Sdc::SchemeType scheme, int level, const std::string& path,
+    const OutOfCoreExportOptions& options, OutOfCoreExportStats* stats)
+{
+    if (stats) *stats = OutOfCoreExportStats();
+    level = std::max(0, level);
+
+    std::unique_ptr<Far::TopologyRefiner> baseRefiner = createTopologyRefiner(mesh, scheme);
+    if (!baseRefiner) {
+        std::cerr << "[OutOfCoreExport] Error: failed to create topology refiner\n";
+        return false;
+    }
+    const Far::TopologyLevel& base = baseRefiner->GetLevel(0);
+    const int numBaseVertices = base.GetNumVertices();
+    const int numBaseFaces = base.GetNumFaces();
+    if (scheme == Sdc::SCHEME_LOOP && !isTriangleMesh(mesh)) {
+        std::cerr << "[OutOfCoreExport] Error: Loop needs a triangulated cage\n";
+        return false;
+    }
+
+    // Index layout: base vertices, then 2^level - 1 points per base edge, then each face's interior
+    const size_t pointsPerEdge = ((size_t)1 << level) - 1;
+    const size_t edgeBase = (size_t)numBaseVertices;
+    const size_t interiorBase = edgeBase + (size_t)base.GetNumEdges() * pointsPerEdge;
+    std::vector<size_t> faceInteriorOffset(numBaseFaces + 1, interiorBase);
+    size_t numTriangles = 0;
+    for (int f = 0; f < numBaseFaces; ++f) {
+        const int n = base.GetFaceVertices(f).size();
+        faceInteriorOffset[f + 1] = faceInteriorOffset[f] + interiorVerticesPerBaseFace(scheme, n, level);
+        numTriangles += level > 0 ? childFacesPerBaseFace(scheme, n, level) * (scheme == Sdc::SCHEME_LOOP ? 1 : 2) : (size_t)(n - 2);
+    }
+    const size_t numVertices = faceInteriorOffset[numBaseFaces];
+    if (numVertices > 0xffffffffull) {
+        std::cerr << "[OutOfCoreExport] Error: " << numVertices << " vertices do not fit 32-bit indices\n";
+        return false;
+    }
+
+    PlyStreamWriter writer;
+    if (!writer.Open(path, numVertices, numTriangles)) return false;
+
+    const size_t facesPerGroup = std::max<size_t>(1, options.tileTriangles >> (2 * level));
+    const std::vector<std::vector<int>> groups = groupFaces(base, facesPerGroup);
+
+    std::vector<int> localOf(numBaseVertices, -1); // base vertex -> tile vertex, reset after each tile
+    std::vector<char> inTile(numBaseFaces, 0);
+    for (const std::vector<int>& group : groups) {
+        TRACE_SCOPE("export_tile");
+
+        // Group faces first so their descendants form a prefix of every refined level, then the
+        // one-ring faces that only provide context
+        std::vector<int> tileFaces = group;
+        for (int f : group) inTile[f] = 1;
+        for (int f : group) {
+            for (Far::Index v : base.GetFaceVertices(f)) {
+                for (Far::Index ring : base.GetVertexFaces(v)) {
+                    if (inTile[ring]) continue;
+                    inTile[ring] = 1;
+                    tileFaces.push_back(ring);
+                }
+            }
+        }
+
+        std::vector<int> globalOf;
+        std::vector<unsigned int> tileIndices;
+        std::vector<int> tileVertsPerFace;
+        for (int f : tileFaces) {
+            Far::ConstIndexArray fv = base.GetFaceVertices(f);
+            tileVertsPerFace.push_back(fv.size());
+            for (Far::Index v : fv) {
+                if (localOf[v] < 0) {
+                    localOf[v] = (int)globalOf.size();
+                    globalOf.push_back(v);
+                }
+                tileIndices.push_back((unsigned int)localOf[v]);
+            }
+        }
+        for (int f : tileFaces) inTile[f] = 0;
+        for (int v : globalOf) localOf[v] = -1;
+
+        MeshData tile;
+        std::vector<glm::vec3> tilePositions(globalOf.size());
+        std::vector<glm::vec2> tileUvs(globalOf.size(), glm::vec2(0.0f));
+        for (size_t i = 0; i < globalOf.size(); ++i) {
+            tilePositions[i] = mesh.vertices[globalOf[i]];
+            if (mesh.uvs.size() == mesh.vertices.size()) tileUvs[i] = mesh.uvs[globalOf[i]];
+        }
+        tile.vertices = std::move(tilePositions);
+        tile.uvs = std::move(tileUvs);
+        tile.indices = std::move(tileIndices);
+        tile.vertsPerFace = std::move(tileVertsPerFace);
+
+        std::unique_ptr<Far::TopologyRefiner> refiner = createTopologyRefiner(tile, scheme);
+        if (!refiner) {
+            std::cerr << "[OutOfCoreExport] Error: failed to create a tile refiner\n";
+            return false;
+        }
+        if (level > 0) {
+            TRACE_SCOPE("refine");
+            refiner->RefineUniform(Far::TopologyRefiner::UniformOptions(level));
+        }
+
+        // Positions (vertex interpolation) and origins (varying) ping-pong one level at a time
+        std::vector<Vertex> verts, next;
+        fillControlVertices(tile, verts);
+        std::vector<Origin> origins(verts.size()), nextOrigins;
+        for (size_t i = 0; i < origins.size(); ++i) {
+            origins[i].Clear();
+            origins[i].Add((int)i, 1.0f);
+        }
+        {
+            TRACE_SCOPE("interpolate");
+            Far::PrimvarRefiner primvarRefiner(*refiner);
+            for (int l = 1; l <= level; ++l) {
+                const size_t count = (size_t)refiner->GetLevel(l).GetNumVertices();
+                next.resize(count);
+                nextOrigins.resize(count);
+                const Vertex* src = verts.data();
+                Vertex* dst = next.data();
+                primvarRefiner.Interpolate(l, src, dst);
+                const Origin* srcOrigins = origins.data();
+                Origin* dstOrigins = nextOrigins.data();
+                primvarRefiner.InterpolateVarying(l, srcOrigins, dstOrigins);
+                verts.swap(next);
+                origins.swap(nextOrigins);
+            }
+        }
+        std::vector<Vertex>().swap(next);
+        std::vector<Origin>().swap(nextOrigins);
+
+        // Triangles of the whole tile for the normals; the group's come first
+        const Far::TopologyLevel& last = refiner->GetLevel(level);
+        size_t groupChildFaces = 0;
+        for (int f : group) groupChildFaces += childFacesPerBaseFace(scheme, base.GetFaceVertices(f).size(), level);
+        std::vector<unsigned int> triangles;
+        extractTriangleIndices(last, 0, triangles);
+        size_t groupTriangles = 0;
+        for (size_t f = 0; f < groupChildFaces; ++f) groupTriangles += (size_t)last.GetFaceVertices((Far::Index)f).size() - 2;
+        VertexFaceAdjacency adjacency;
+        buildVertexFaceAdjacency(triangles.data(), triangles.size() / 3, verts.size(), adjacency);
+        recomputeNormals(verts, triangles, adjacency, options.numThreads);
+
+        // The ping-pong buffers peaked at two levels each
+        size_t tileBytes = verts.size() * 2 * (sizeof(Vertex) + sizeof(Origin)) + triangles.size() * sizeof(unsigned int)
+            + (adjacency.offsets.size() + adjacency.faces.size()) * sizeof(unsigned int);
+        for (int l = 0; l <= level; ++l) tileBytes += estimateTopologyLevelBytes(refiner->GetLevel(l));
+
+        // Number every vertex the group uses. Interior points are counted per base face in the
+        // order its descendants reach them, which does not depend on what else is in the tile.
+        constexpr unsigned int kUnassigned = 0xffffffffu;
+        std::vector<unsigned int> globalIndex(verts.size(), kUnassigned);
+        const float segments = (float)((size_t)1 << level);
+        size_t childFace = 0;
+        for (size_t g = 0; g < group.size(); ++g) {
+            const int baseFace = group[g];
+            size_t interior = 0;
+            const size_t faceEnd = childFace + childFacesPerBaseFace(scheme, base.GetFaceVertices(baseFace).size(), level);
+            for (; childFace < faceEnd; ++childFace) {
+                for (Far::Index v : last.GetFaceVertices((Far::Index)childFace)) {
+                    if (globalIndex[v] != kUnassigned) continue;
+                    const Origin& origin = origins[v];
+                    size_t index = 0;
+                    if (origin.count == 1) {
+                        index = (size_t)globalOf[origin.vertices[0]];
+                    }
+                    else if (origin.count == 2) {
+                        // Parameter along the edge, counted from its lower-numbered base vertex
+                        const int a = globalOf[origin.vertices[0]], b = globalOf[origin.vertices[1]];
+                        const float towardHigh = a > b ? origin.weights[0] : origin.weights[1];
+                        const long k = std::lround(towardHigh * segments);
+                        const Far::Index baseEdge = base.FindEdge(a, b);
+                        if (baseEdge < 0 || k < 1 || (size_t)k > pointsPerEdge) {
+                            std::cerr << "[OutOfCoreExport] Error: refined vertex off its base edge\n";
+                            return false;
+                        }
+                        index = edgeBase + (size_t)baseEdge * pointsPerEdge + (size_t)(k - 1);
+                    }
+                    else {
+                        index = faceInteriorOffset[baseFace] + interior++;
+                        if (index >= faceInteriorOffset[baseFace + 1]) {
+                            std::cerr << "[OutOfCoreExport] Error: base face " << baseFace << " has more interior points than expected\n";
+                            return false;
+                        }
+                    }
+                    globalIndex[v] = (unsigned int)index;
+                }
+            }
+            if (faceInteriorOffset[baseFace] + interior != faceInteriorOffset[baseFace + 1]) {
+                std::cerr << "[OutOfCoreExport] Error: base face " << baseFace << " has fewer interior points than expected\n";
+                return false;
+            }
+        }
+
+        // Write the group's vertices in runs of consecutive indices (interior points and edge
+        // points mostly are)
+        std::vector<std::pair<unsigned int, unsigned int>> order; // global, tile
+        for (size_t v = 0; v < globalIndex.size(); ++v)
+            if (globalIndex[v] != kUnassigned) order.emplace_back(globalIndex[v], (unsigned int)v);
+        std::sort(order.begin(), order.end());
+        std::vector<Vertex> run;
+        for (size_t begin = 0; begin < order.size();) {
+            size_t end = begin + 1;
+            while (end < order.size() && order[end].first == order[end - 1].first + 1) ++end;
+            run.clear();
+            for (size_t i = begin; i < end; ++i) run.push_back(verts[order[i].second]);
+            if (!writer.WriteVertices(order[begin].first, run.data(), run.size())) return false;
+            begin = end;
+        }
+
+        triangles.resize(groupTriangles * 3);
+        for (unsigned int& index : triangles) index = globalIndex[index];
+        if (!writer.AppendTriangles(triangles.data(), groupTriangles)) return false;
+
+        if (stats) {
+            stats->tiles++;
+            stats->groupFaces += group.size();
+            stats->contextFaces += tileFaces.size() - group.size();
+            stats->peakTileBytes = std::max(stats->peakTileBytes, tileBytes);
+        }
+    }
+
+    size_t bytesWritten = 0;
+    if (!writer.Close(&bytesWritten)) return false;
+    if (stats) {
+        stats->vertices = numVertices;
+        stats->triangles = numTriangles;
+        stats->bytesWritten = bytesWritten;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include "Subdivision.h"
+
+struct OutOfCoreExportOptions {
+    size_t tileTriangles = 1 << 20; // output triangles per tile; sets how many base faces a group takes
+    unsigned int numThreads = 0;    // normals; 0 uses every worker of the global pool
+};
+
+struct OutOfCoreExportStats {
+    size_t tiles = 0;
+    size_t groupFaces = 0;   // base faces exported
+    size_t contextFaces = 0; // one-ring faces refined only as context, summed over tiles
+    size_t vertices = 0;
+    size_t triangles = 0;
+    size_t peakTileBytes = 0; // largest tile: estimated topology of every level plus vertex buffers
+    size_t bytesWritten = 0;
+};
+
+// Rough peak for exportSubdividedPly on this cage, e.g. to reserve memory before starting it
+size_t estimateOutOfCoreExportBytes(const OpenSubdiv::Far::TopologyLevel& base, OpenSubdiv::Sdc::SchemeType scheme, int level,
+    const OutOfCoreExportOptions& options);
+
+// Writes mesh refined to level as binary PLY without holding the refined mesh in memory. Base faces
+// are grown into compact groups of about options.tileTriangles output triangles; each group is
+// refined together with its one-ring (every face sharing a vertex with it), which is all the
+// refined vertices and normals over the group depend on, and only the group's part is written.
+// A refined vertex is numbered by what it descends from: base vertex v keeps index v, the points
+// inside base edge e follow the base vertices in edge order, then the points inside each base face
+// in face order. Vertices on group seams get the same index from either side without a global map,
+// and the numbering does not depend on the tile size. Peak memory depends on the tile size and the
+// base cage, not on the output size.
+bool exportSubdividedPly(const MeshData& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, const std::string& path,
+    const OutOfCoreExportOptions& options = {}, OutOfCoreExportStats* stats = nullptr);
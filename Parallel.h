@@ -0,0 +1,25 @@
+#pragma once
+
+#include <thread>
+
+#include "ThreadPool.h"
+
+inline unsigned int defaultThreadCount()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Splits [begin, end) into numThreads contiguous chunks (0: hardware concurrency) and runs
+// fn(chunkBegin, chunkEnd) on the global thread pool. The calling thread takes the first chunk.
+template <typename Fn>
+void parallelFor(size_t begin, size_t end, Fn&& fn, unsigned int numThreads = 0)
+{
+    if (end <= begin) return;
+    if (numThreads == 0) numThreads = defaultThreadCount();
+    if (numThreads == 1) {
+        fn(begin, end);
+        return;
+    }
+    ThreadPool::Global().ParallelFor(begin, end, numThreads, fn, numThreads);
+}
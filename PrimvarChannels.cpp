@@ -0,0 +1,229 @@
+#include "PrimvarChannels.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <opensubdiv/far/primvarRefiner.h>
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+static_assert(sizeof(Vertex) == 8 * sizeof(float) && offsetof(Vertex, normal) == 3 * sizeof(float)
+    && offsetof(Vertex, uv) == 6 * sizeof(float), "stencil kernel writes Vertex as two float4 halves");
+
+namespace {
+
+// Same split as evaluateStencils
+constexpr size_t kMinStencilsPerChunk = 4096;
+
+// Sets without a specialization go to the next larger one (normals imply the full layout)
+unsigned int specializedChannels(unsigned int channels)
+{
+    if (channels & PRIMVAR_NORMAL) return PRIMVAR_ALL;
+    if (channels & PRIMVAR_UV) return PRIMVAR_POSITION_UV;
+    return PRIMVAR_POSITION;
+}
+
+template <unsigned int Channels>
+void toChannelVertex(const Vertex& v, ChannelVertex<Channels>& c)
+{
+    typedef ChannelVertex<Channels> CV;
+    c.Clear();
+    c.values[0] = v.pos.x;
+    c.values[1] = v.pos.y;
+    c.values[2] = v.pos.z;
+    if constexpr ((Channels & PRIMVAR_NORMAL) != 0) {
+        c.values[CV::kNormalOffset + 0] = v.normal.x;
+        c.values[CV::kNormalOffset + 1] = v.normal.y;
+        c.values[CV::kNormalOffset + 2] = v.normal.z;
+    }
+    if constexpr ((Channels & PRIMVAR_UV) != 0) {
+        c.values[CV::kUvOffset + 0] = v.uv.x;
+        c.values[CV::kUvOffset + 1] = v.uv.y;
+    }
+}
+
+template <unsigned int Channels>
+void fromChannelVertex(const ChannelVertex<Channels>& c, Vertex& v)
+{
+    typedef ChannelVertex<Channels> CV;
+    v.Clear();
+    v.pos = glm::vec3(c.values[0], c.values[1], c.values[2]);
+    if constexpr ((Channels & PRIMVAR_NORMAL) != 0) {
+        v.normal = glm::vec3(c.values[CV::kNormalOffset], c.values[CV::kNormalOffset + 1], c.values[CV::kNormalOffset + 2]);
+    }
+    if constexpr ((Channels & PRIMVAR_UV) != 0) {
+        v.uv = glm::vec2(c.values[CV::kUvOffset], c.values[CV::kUvOffset + 1]);
+    }
+}
+
+template <unsigned int Channels>
+void interpolateLevels(const Far::TopologyRefiner& refiner, int fromLevel, int toLevel, const Vertex* src, Vertex* dst)
+{
+    // Intermediate levels stay in the narrow layout; only the ends are converted
+    std::vector<ChannelVertex<Channels>> in((size_t)refiner.GetLevel(fromLevel).GetNumVertices()), result;
+    for (size_t i = 0; i < in.size(); ++i) toChannelVertex(src[i], in[i]);
+
+    Far::PrimvarRefiner primvarRefiner(refiner);
+    for (int level = fromLevel + 1; level <= toLevel; ++level) {
+        result.resize((size_t)refiner.GetLevel(level).GetNumVertices());
+        const ChannelVertex<Channels>* s = in.data();
+        ChannelVertex<Channels>* d = result.data();
+        primvarRefiner.Interpolate(level, s, d);
+        in.swap(result);
+    }
+
+    for (size_t i = 0; i < in.size(); ++i) fromChannelVertex(in[i], dst[i]);
+}
+
+// Stencils [begin, end): every weight is applied in table order, like StencilTable::UpdateValues
+template <unsigned int Channels>
+void evaluateRange(const Far::StencilTable& stencils, const PrimvarBuffer& control, Vertex* out, size_t begin, size_t end)
+{
+    const int* sizes = stencils.GetSizes().data();
+    const Far::Index* offsets = stencils.GetOffsets().data();
+    const Far::Index* controlIndices = stencils.GetControlIndices().data();
+    const float* weights = stencils.GetWeights().data();
+    const float* positions = control.positions.data();
+    const float* normals = control.normals.data();
+    const float* uvs = control.uvs.data();
+
+    for (size_t i = begin; i < end; ++i) {
+        const Far::Index* index = controlIndices + offsets[i];
+        const float* weight = weights + offsets[i];
+        const int size = sizes[i];
+        float* dst = &out[i].pos.x;
+
+#if defined(PRIMVAR_CHANNELS_USE_SSE)
+        __m128 pos = _mm_setzero_ps();
+        __m128 normal = _mm_setzero_ps();
+        __m128 uv = _mm_setzero_ps();
+        for (int j = 0; j < size; ++j) {
+            const __m128 w = _mm_set1_ps(weight[j]);
+            const size_t c = (size_t)index[j];
+            pos = _mm_add_ps(pos, _mm_mul_ps(_mm_loadu_ps(positions + c * 4), w));
+            if constexpr ((Channels & PRIMVAR_NORMAL) != 0) {
+                normal = _mm_add_ps(normal, _mm_mul_ps(_mm_loadu_ps(normals + c * 4), w));
+            }
+            if constexpr ((Channels & PRIMVAR_UV) != 0) {
+                const __m128 row = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(uvs + c * 2)));
+                uv = _mm_add_ps(uv, _mm_mul_ps(row, w));
+            }
+        }
+
+        // Vertex is (px py pz nx | ny nz u v); the unused lanes of each row stay +0
+        if constexpr ((Channels & PRIMVAR_NORMAL) != 0) {
+            const __m128 t = _mm_shuffle_ps(pos, normal, _MM_SHUFFLE(0, 0, 2, 2));
+            _mm_storeu_ps(dst, _mm_shuffle_ps(pos, t, _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(dst + 4, _mm_shuffle_ps(normal, uv, _MM_SHUFFLE(1, 0, 2, 1)));
+        }
+        else {
+            _mm_storeu_ps(dst, pos);
+            _mm_storeu_ps(dst + 4, _mm_movelh_ps(_mm_setzero_ps(), uv));
+        }
+#else
+        float acc[8] = {};
+        for (int j = 0; j < size; ++j) {
+            const float w = weight[j];
+            const size_t c = (size_t)index[j];
+            for (int k = 0; k < 3; ++k) acc[k] += positions[c * 4 + k] * w;
+            if constexpr ((Channels & PRIMVAR_NORMAL) != 0) {
+                for (int k = 0; k < 3; ++k) acc[3 + k] += normals[c * 4 + k] * w;
+            }
+            if constexpr ((Channels & PRIMVAR_UV) != 0) {
+                acc[6] += uvs[c * 2] * w;
+                acc[7] += uvs[c * 2 + 1] * w;
+            }
+        }
+        std::copy(acc, acc + 8, dst);
+#endif
+    }
+}
+
+template <unsigned int Channels>
+void evaluateChannels(const Far::StencilTable& stencils, const PrimvarBuffer& control, Vertex* out, unsigned int numThreads)
+{
+    const size_t numStencils = (size_t)stencils.GetNumStencils();
+    if (numStencils == 0) return;
+
+    ThreadPool& pool = ThreadPool::Global();
+    if (numThreads == 0) numThreads = pool.GetThreadCount();
+    size_t numChunks = std::min<size_t>((size_t)numThreads * 4, (numStencils + kMinStencilsPerChunk - 1) / kMinStencilsPerChunk);
+
+    if (numThreads <= 1 || numChunks <= 1) {
+        evaluateRange<Channels>(stencils, control, out, 0, numStencils);
+        return;
+    }
+
+    pool.ParallelFor(0, numStencils, numChunks, [&](size_t begin, size_t end) {
+        evaluateRange<Channels>(stencils, control, out, begin, end);
+    }, numThreads);
+}
+
+}
+
+unsigned int primvarChannelsFor(const MeshData& mesh)
+{
+    for (const glm::vec2& uv : mesh.uvs) {
+        if (uv.x != 0.0f || uv.y != 0.0f) return PRIMVAR_POSITION_UV;
+    }
+    return PRIMVAR_POSITION;
+}
+
+const char* primvarChannelsName(unsigned int channels)
+{
+    switch (specializedChannels(channels)) {
+    case PRIMVAR_POSITION: return "position";
+    case PRIMVAR_POSITION_UV: return "position+uv";
+    default: return "all";
+    }
+}
+
+void PrimvarBuffer::Load(const Vertex* verts, size_t count, unsigned int requested)
+{
+    channels = specializedChannels(requested);
+    size = count;
+
+    // assign keeps the capacity, so reloading the same cage every frame does not allocate
+    positions.assign(count * 4, 0.0f);
+    normals.assign((channels & PRIMVAR_NORMAL) ? count * 4 : 0, 0.0f);
+    uvs.assign((channels & PRIMVAR_UV) ? count * 2 : 0, 0.0f);
+
+    for (size_t i = 0; i < count; ++i) {
+        positions[i * 4 + 0] = verts[i].pos.x;
+        positions[i * 4 + 1] = verts[i].pos.y;
+        positions[i * 4 + 2] = verts[i].pos.z;
+        if (channels & PRIMVAR_NORMAL) {
+            normals[i * 4 + 0] = verts[i].normal.x;
+            normals[i * 4 + 1] = verts[i].normal.y;
+            normals[i * 4 + 2] = verts[i].normal.z;
+        }
+        if (channels & PRIMVAR_UV) {
+            uvs[i * 2 + 0] = verts[i].uv.x;
+            uvs[i * 2 + 1] = verts[i].uv.y;
+        }
+    }
+}
+
+void evaluateStencilChannels(const Far::StencilTable& stencils, const PrimvarBuffer& control, Vertex* out, unsigned int numThreads)
+{
+    TRACE_SCOPE("interpolate");
+    switch (control.channels) {
+    case PRIMVAR_POSITION: evaluateChannels<PRIMVAR_POSITION>(stencils, control, out, numThreads); break;
+    case PRIMVAR_POSITION_UV: evaluateChannels<PRIMVAR_POSITION_UV>(stencils, control, out, numThreads); break;
+    default: evaluateChannels<PRIMVAR_ALL>(stencils, control, out, numThreads); break;
+    }
+}
+
+void interpolatePrimvarChannels(const Far::TopologyRefiner& refiner, int fromLevel, int toLevel, const Vertex* src, Vertex* dst,
+    unsigned int channels)
+{
+    TRACE_SCOPE("interpolate");
+    switch (specializedChannels(channels)) {
+    case PRIMVAR_POSITION: interpolateLevels<PRIMVAR_POSITION>(refiner, fromLevel, toLevel, src, dst); break;
+    case PRIMVAR_POSITION_UV: interpolateLevels<PRIMVAR_POSITION_UV>(refiner, fromLevel, toLevel, src, dst); break;
+    default: interpolateLevels<PRIMVAR_ALL>(refiner, fromLevel, toLevel, src, dst); break;
+    }
+}
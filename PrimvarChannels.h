@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PRIMVAR_CHANNELS_USE_SSE 1
+#endif
+
+#include <opensubdiv/far/stencilTable.h>
+
+#include "Subdivision.h"
+
+// Which parts of Vertex a refinement pass carries. Normals are recomputed from the refined
+// triangles everywhere, so interpolating them is only useful for checking against the full layout.
+enum PrimvarChannel : unsigned int {
+    PRIMVAR_POSITION = 1u << 0,
+    PRIMVAR_NORMAL = 1u << 1,
+    PRIMVAR_UV = 1u << 2,
+    PRIMVAR_POSITION_UV = PRIMVAR_POSITION | PRIMVAR_UV,
+    PRIMVAR_ALL = PRIMVAR_POSITION | PRIMVAR_NORMAL | PRIMVAR_UV
+};
+
+// Position always, uv only when the cage has a non-zero one
+unsigned int primvarChannelsFor(const MeshData& mesh);
+
+// "position", "position+uv" or "all" for the three specialized sets
+const char* primvarChannelsName(unsigned int channels);
+
+// Primvar for Far::PrimvarRefiner holding only the selected channels, padded to whole float4
+// groups so AddWithWeight is one SSE multiply-add per group: position-only is 16 bytes against
+// the 32 of Vertex. Per lane the arithmetic is the same as Vertex::AddWithWeight, so the selected
+// channels come out bit-identical.
+template <unsigned int Channels>
+struct ChannelVertex {
+    static constexpr int kNormalOffset = 3;
+    static constexpr int kUvOffset = (Channels & PRIMVAR_NORMAL) ? 6 : 3;
+    static constexpr int kFloats = kUvOffset + ((Channels & PRIMVAR_UV) ? 2 : 0);
+    static constexpr int kGroups = (kFloats + 3) / 4;
+    static_assert(Channels & PRIMVAR_POSITION, "every channel set carries positions");
+
+    alignas(16) float values[kGroups * 4];
+
+    void Clear(void* = 0)
+    {
+        for (float& v : values) v = 0.0f;
+    }
+
+    void AddWithWeight(const ChannelVertex& src, float weight)
+    {
+#if defined(PRIMVAR_CHANNELS_USE_SSE)
+        const __m128 w = _mm_set1_ps(weight);
+        for (int g = 0; g < kGroups; ++g) {
+            __m128 acc = _mm_load_ps(values + g * 4);
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(src.values + g * 4), w));
+            _mm_store_ps(values + g * 4, acc);
+        }
+#else
+        for (int i = 0; i < kGroups * 4; ++i) values[i] += src.values[i] * weight;
+#endif
+    }
+};
+
+// Channel-major copy of the control vertices for the stencil path: positions (and normals) as
+// float4 rows with w = 0, uvs as float2 rows. Each stencil then gathers only the rows it needs.
+// Kept by callers that evaluate every frame so reloading does not allocate.
+struct PrimvarBuffer {
+    unsigned int channels = PRIMVAR_POSITION;
+    size_t size = 0;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+
+    void Load(const Vertex* verts, size_t count, unsigned int channels);
+};
+
+// Stencil pass over a channel buffer: SSE accumulation of the selected channels only, with the
+// control rows gathered per stencil weight. Writes a whole Vertex per stencil; channels not in the
+// buffer come out zero. Summation order and chunking match evaluateStencils, so the selected
+// channels are bit-identical to it for any thread count. numThreads == 0 uses all workers.
+void evaluateStencilChannels(const OpenSubdiv::Far::StencilTable& stencils, const PrimvarBuffer& control, Vertex* out,
+    unsigned int numThreads = 0);
+
+// PrimvarRefiner::Interpolate from fromLevel to toLevel of a uniformly refined refiner through
+// ChannelVertex<channels>: src holds the vertices of fromLevel, dst receives those of toLevel, and
+// only the ends are converted from and to Vertex.
+void interpolatePrimvarChannels(const OpenSubdiv::Far::TopologyRefiner& refiner, int fromLevel, int toLevel, const Vertex* src,
+    Vertex* dst, unsigned int channels);
@@ -1,120 +1,373 @@
-#include <map> // Used for vertex deduplication logic
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
 #include <iostream>
 #include "ResourceManager.h"
+#include "VertexWelder.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "MeshPrimitives.h"
+#include "Trace.h"
+#include "MappedFile.h"
+#include "Normals.h"
+#include "ThreadPool.h"
+#include <glm/gtc/type_ptr.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 
+DerivedKey::DerivedKey(std::string_view name, int scheme, int level, uint32_t kind, uint64_t variant)
+    : nameHash(std::hash<std::string_view>()(name)), scheme(scheme), level(level), kind(kind), variant(variant) {
+    name.copy(this->name, kNameChars);
+}
+
+size_t DerivedKeyHash::operator()(const DerivedKey& key) const {
+    size_t h = (size_t)key.nameHash;
+    for (uint64_t v : { (uint64_t)(uint32_t)key.scheme, (uint64_t)(uint32_t)key.level, (uint64_t)key.kind, key.variant })
+        h ^= std::hash<uint64_t>()(v) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+size_t MeshData::MemoryBytes() const {
+    return sizeof(MeshData) + vertices.MemoryBytes() + normals.MemoryBytes() + uvs.MemoryBytes()
+        + indices.MemoryBytes() + vertsPerFace.MemoryBytes() + (backing ? backing->Size() : 0);
+}
+
+ResourceManager::~ResourceManager() {
+    std::vector<std::shared_ptr<PendingLoad>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [name, load] : pendingLoads) pending.push_back(load);
+    }
+    for (auto& load : pending) {
+        // Not started: claim it so the queued task never touches this object
+        if (!load->claimed.exchange(true)) load->promise.set_value(nullptr);
+        load->future.wait();
+    }
+}
+
 void ResourceManager::RegisterResource(const std::string& name, const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(mutex);
     registeredResources[name] = path;
 }
 
-std::shared_ptr<MeshData> ResourceManager::GetMesh(const std::string& name) {
+std::shared_ptr<ResourceManager::PendingLoad> ResourceManager::FindOrStartLoad(const std::string& name, std::shared_ptr<MeshData>& cached, bool& isNew) {
+    isNew = false;
+    std::lock_guard<std::mutex> lock(mutex);
     if (auto it = resourceCache.find(name); it != resourceCache.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        stats.meshHits++;
+        cached = std::const_pointer_cast<MeshData>(std::static_pointer_cast<const MeshData>(it->second->value));
+        return nullptr;
+    }
+    stats.meshMisses++;
+    if (auto it = pendingLoads.find(name); it != pendingLoads.end()) {
         return it->second;
     }
-
-    auto it = registeredResources.find(name);
-	if (it == registeredResources.end()) {
+    if (registeredResources.find(name) == registeredResources.end()) {
 		std::cerr << "[ResourceManager] Error: Failed to load mesh " << name << "' not registered.\n";
-		return nullptr;
-	}
+        return nullptr;
+    }
+
+    auto pending = std::make_shared<PendingLoad>();
+    pendingLoads[name] = pending;
+    isNew = true;
+    return pending;
+}
+
+std::shared_ptr<MeshData> ResourceManager::GetMesh(const std::string& name) {
+    std::shared_ptr<MeshData> cached;
+    bool isNew;
+    std::shared_ptr<PendingLoad> pending = FindOrStartLoad(name, cached, isNew);
+    if (!pending) return cached;
+
+    // Load here unless another thread already started
+    if (!pending->claimed.exchange(true)) RunLoad(name, pending);
+    return pending->future.get();
+}
 
-    std::cout << "[ResourceManager] Loading: " << it->second << " ... ";
-    std::shared_ptr<MeshData> mesh = LoadMeshFromFile(it->second);
+ResourceManager::MeshHandle ResourceManager::GetMeshAsync(const std::string& name) {
+    std::shared_ptr<MeshData> cached;
+    bool isNew;
+    std::shared_ptr<PendingLoad> pending = FindOrStartLoad(name, cached, isNew);
+    if (!pending) {
+        std::promise<std::shared_ptr<MeshData>> ready;
+        ready.set_value(cached);
+        return ready.get_future().share();
+    }
+
+    if (isNew) {
+        ThreadPool::Global().Submit([this, name, pending]() {
+            if (!pending->claimed.exchange(true)) RunLoad(name, pending);
+        });
+    }
+    return pending->future;
+}
+
+void ResourceManager::PrefetchAll() {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [name, path] : registeredResources) names.push_back(name);
+    }
+    for (const std::string& name : names) (void)GetMeshAsync(name);
+}
+
+void ResourceManager::RunLoad(const std::string& name, const std::shared_ptr<PendingLoad>& pending) {
+    std::filesystem::path relativePath;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        relativePath = registeredResources[name];
+    }
+
+    std::shared_ptr<MeshData> mesh;
+    try {
+        mesh = LoadResource(relativePath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[ResourceManager] Error: loading " << name << " threw: " << e.what() << "\n";
+    }
+
+    {
+        // A failed load is forgotten so a later request can retry
+        std::lock_guard<std::mutex> lock(mutex);
+        if (mesh) InsertEntry(CacheEntry{ name, DerivedKey(), mesh, std::type_index(typeid(MeshData)), mesh->MemoryBytes() });
+        pendingLoads.erase(name);
+    }
+    pending->promise.set_value(mesh);
+}
+
+void ResourceManager::SetMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryBudget = bytes;
+    EvictToBudget();
+}
+
+size_t ResourceManager::GetMemoryBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryBudget;
+}
+
+void ResourceManager::PutDerivedErased(const DerivedKey& key, std::shared_ptr<const void> value, std::type_index type, size_t bytes) {
+    if (!value) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    // Would only push everything else out and then be evicted itself
+    if (memoryBudget != 0 && bytes > memoryBudget) return;
+    InsertEntry(CacheEntry{ std::string(), key, std::move(value), type, bytes });
+}
 
+std::shared_ptr<const void> ResourceManager::FindDerivedErased(const DerivedKey& key, std::type_index type) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = derivedCache.find(key);
+    if (it == derivedCache.end() || it->second->type != type) {
+        stats.derivedMisses++;
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    stats.derivedHits++;
+    return it->second->value;
+}
+
+ResourceManager::CacheStats ResourceManager::GetCacheStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    CacheStats s = stats;
+    s.entries = lru.size();
+    s.bytes = cachedBytes;
+    s.budget = memoryBudget;
+    for (const CacheEntry& entry : lru) {
+        if (entry.IsPinned()) s.pinnedBytes += entry.bytes;
+    }
+    return s;
+}
+
+void ResourceManager::InsertEntry(CacheEntry entry) {
+    EraseEntry(entry);
+    cachedBytes += entry.bytes;
+    lru.push_front(std::move(entry));
+    if (lru.front().key.empty()) derivedCache[lru.front().derivedKey] = lru.begin();
+    else resourceCache[lru.front().key] = lru.begin();
+    EvictToBudget();
+}
+
+void ResourceManager::EraseEntry(const CacheEntry& entry) {
+    std::list<CacheEntry>::iterator node;
+    if (entry.key.empty()) {
+        auto it = derivedCache.find(entry.derivedKey);
+        if (it == derivedCache.end()) return;
+        node = it->second;
+        derivedCache.erase(it);
+    }
+    else {
+        auto it = resourceCache.find(entry.key);
+        if (it == resourceCache.end()) return;
+        node = it->second;
+        resourceCache.erase(it);
+    }
+    cachedBytes -= node->bytes;
+    lru.erase(node);
+}
+
+void ResourceManager::EvictToBudget() {
+    if (memoryBudget == 0) return;
+    for (auto it = lru.end(); it != lru.begin() && cachedBytes > memoryBudget;) {
+        --it;
+        if (it->IsPinned()) continue;
+        cachedBytes -= it->bytes;
+        if (it->key.empty()) derivedCache.erase(it->derivedKey);
+        else resourceCache.erase(it->key);
+        it = lru.erase(it);
+        stats.evictions++;
+    }
+}
+
+std::shared_ptr<MeshData> ResourceManager::LoadResource(const std::filesystem::path& relativePath) {
+    TRACE_SCOPE("load");
+    std::filesystem::path rootPah = PROJECT_ROOT_DIR;
+    std::filesystem::path fullPath = rootPah / relativePath;
+
+    // Try the binary cache first: a valid entry is mapped and viewed in place
+    MeshCacheSource source;
+    bool useMeshCache = !meshCacheDir.empty() &&
+        describeMeshSource(fullPath, meshCacheValidation == MeshCacheValidation::Hash, source);
+    std::filesystem::path cachePath = useMeshCache ? MeshCachePath(fullPath) : std::filesystem::path();
+
+    if (useMeshCache) {
+        if (auto cached = loadMeshCache(cachePath, source, meshCacheValidation == MeshCacheValidation::Hash)) {
+            std::cout << "[ResourceManager] Mapped cache: " << cachePath << " (" << cached->vertices.size() << " verts)\n";
+            return cached;
+        }
+    }
+
+    // One line per load: several loads may be logging at once
+    std::shared_ptr<MeshData> mesh = LoadMeshFromFile(fullPath);
     if (mesh) {
-        resourceCache[name] = mesh;
-        std::cout << "Success (" << mesh->vertices.size() << " verts)\n";
+        std::cout << "[ResourceManager] Loaded: " << relativePath << " (" << mesh->vertices.size() << " verts)\n";
+
+        if (useMeshCache && !writeMeshCache(cachePath, *mesh, source))
+            std::cerr << "[ResourceManager] Warning: could not write mesh cache " << cachePath << "\n";
     }
     else {
-        std::cout << "Failed\n";
+        std::cout << "[ResourceManager] Loading " << relativePath << " failed\n";
     }
 
     return mesh;
 }
 
-std::shared_ptr<MeshData> ResourceManager::LoadMeshFromFile(const std::filesystem::path& path) {
-	std::filesystem::path rootPah = PROJECT_ROOT_DIR;
-	std::filesystem::path fullPath = rootPah / path;
+std::filesystem::path ResourceManager::MeshCachePath(const std::filesystem::path& fullPath) const {
+    // The path hash keeps same-named assets from different folders apart
+    size_t pathHash = std::hash<std::string>()(fullPath.lexically_normal().generic_string());
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.meshbin", (unsigned long long)pathHash);
+    return meshCacheDir / (fullPath.filename().string() + suffix);
+}
+
+// Below this many corners the thread start-up costs more than the weld itself
+static constexpr size_t kParallelWeldCorners = 1u << 20;
 
+// Face corners of every mesh in the scene, in file order; polygons keep their arity
+static bool gatherAssimpCorners(const std::filesystem::path& fullPath, std::vector<glm::vec3>& corners, std::vector<int>& faceSizes) {
     Assimp::Importer importer;
     importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS,
         aiComponent_NORMALS | aiComponent_TEXCOORDS | aiComponent_COLORS | aiComponent_TANGENTS_AND_BITANGENTS);
 
-    const aiScene* scene = importer.ReadFile(fullPath.string(), aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene* scene = importer.ReadFile(fullPath.string(), aiProcess_FlipUVs);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-        return nullptr;
+        return false;
     }
 
-    auto meshData = std::make_shared<MeshData>();
-
-    // Vertex deduplication helper
-    struct Vec3Cmp {
-        bool operator()(const glm::vec3& a, const glm::vec3& b) const {
-            if (glm::abs(a.x - b.x) > 1e-6f) return a.x < b.x;
-            if (glm::abs(a.y - b.y) > 1e-6f) return a.y < b.y;
-            return a.z < b.z - 1e-6f;
-        }
-    };
-    std::map<glm::vec3, unsigned int, Vec3Cmp> uniqueVerts;
-
     for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
         const aiMesh* mesh = scene->mMeshes[i];
+        corners.reserve(corners.size() + (size_t)mesh->mNumFaces * 3);
+        faceSizes.reserve(faceSizes.size() + mesh->mNumFaces);
         for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
             const aiFace& face = mesh->mFaces[j];
-            if (face.mNumIndices != 3) continue;
-
-            unsigned int triIdx[3];
-            for (int k = 0; k < 3; k++) {
-                glm::vec3 pos(mesh->mVertices[face.mIndices[k]].x,
-                    mesh->mVertices[face.mIndices[k]].y,
-                    mesh->mVertices[face.mIndices[k]].z);
-
-                auto it = uniqueVerts.find(pos);
-                if (it == uniqueVerts.end()) {
-                    unsigned int newIdx = (unsigned int)meshData->vertices.size();
-                    meshData->vertices.push_back(pos);
-                    meshData->normals.push_back(glm::vec3(0, 0, 0));
-                    meshData->uvs.push_back(glm::vec2(0, 0));
-                    uniqueVerts[pos] = newIdx;
-                    triIdx[k] = newIdx;
-                }
-                else {
-                    triIdx[k] = it->second;
-                }
+            if (face.mNumIndices < 3) continue; // points and lines
+
+            faceSizes.push_back((int)face.mNumIndices);
+            for (unsigned int k = 0; k < face.mNumIndices; k++) {
+                const aiVector3D& v = mesh->mVertices[face.mIndices[k]];
+                corners.push_back(glm::vec3(v.x, v.y, v.z));
             }
+        }
+    }
+    return true;
+}
 
-            if (triIdx[0] == triIdx[1] || triIdx[1] == triIdx[2] || triIdx[2] == triIdx[0]) continue;
+static bool isObjFile(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return ext == ".obj";
+}
 
-            meshData->vertsPerFace.push_back(3);
-            meshData->indices.push_back(triIdx[0]);
-            meshData->indices.push_back(triIdx[1]);
-            meshData->indices.push_back(triIdx[2]);
+std::shared_ptr<MeshData> ResourceManager::LoadMeshFromFile(const std::filesystem::path& fullPath) {
+    // Gather face corners, then weld them in one pass. OBJ goes through the native parser;
+    // Assimp handles every other format and OBJ files the native parser rejects.
+    std::vector<glm::vec3> corners;
+    std::vector<int> faceSizes;
+    bool parsed = false;
+    {
+        TRACE_SCOPE("parse");
+        if (useNativeObjParser && isObjFile(fullPath)) {
+            parsed = loadObjCorners(fullPath, corners, faceSizes);
+            if (!parsed) std::cerr << "[ResourceManager] Warning: native OBJ parse failed, retrying with Assimp\n";
+        }
+        if (!parsed) {
+            corners.clear();
+            faceSizes.clear();
+            if (!gatherAssimpCorners(fullPath, corners, faceSizes)) return nullptr;
         }
     }
 
-    // Recalculate Normals
-    for (size_t i = 0; i < meshData->indices.size(); i += 3) {
-        unsigned int i0 = meshData->indices[i];
-        unsigned int i1 = meshData->indices[i + 1];
-        unsigned int i2 = meshData->indices[i + 2];
-        glm::vec3 edge1 = meshData->vertices[i1] - meshData->vertices[i0];
-        glm::vec3 edge2 = meshData->vertices[i2] - meshData->vertices[i0];
-        glm::vec3 crossP = glm::cross(edge1, edge2);
+    auto meshData = std::make_shared<MeshData>();
+    auto& vertices = meshData->vertices.Mutable();
+    auto& normals = meshData->normals.Mutable();
+    auto& uvs = meshData->uvs.Mutable();
+    auto& indices = meshData->indices.Mutable();
+    auto& vertsPerFace = meshData->vertsPerFace.Mutable();
+
+    WeldOptions weldOptions;
+    weldOptions.parallel = corners.size() >= kParallelWeldCorners;
+
+    std::vector<unsigned int> remap;
+    weldPositions(corners.data(), corners.size(), weldOptions, remap, vertices);
+    normals.assign(vertices.size(), glm::vec3(0, 0, 0));
+    uvs.assign(vertices.size(), glm::vec2(0, 0));
 
-        if (glm::length(crossP) > 1e-10f) {
-            meshData->normals[i0] += crossP;
-            meshData->normals[i1] += crossP;
-            meshData->normals[i2] += crossP;
+    // Welding can collapse corners: drop repeats of the previous corner, then any face that still
+    // repeats a vertex or has fewer than three left
+    indices.reserve(remap.size());
+    vertsPerFace.reserve(faceSizes.size());
+    std::vector<unsigned int> face;
+    size_t corner = 0;
+    for (int faceSize : faceSizes) {
+        face.clear();
+        for (int k = 0; k < faceSize; ++k, ++corner) {
+            unsigned int v = remap[corner];
+            if (face.empty() || face.back() != v) face.push_back(v);
         }
+        while (face.size() > 1 && face.back() == face.front()) face.pop_back();
+        if (face.size() < 3) continue;
+
+        bool repeats = false;
+        for (size_t i = 0; i < face.size() && !repeats; ++i)
+            repeats = std::find(face.begin() + i + 1, face.end(), face[i]) != face.end();
+        if (repeats) continue;
+
+        vertsPerFace.push_back((int)face.size());
+        indices.insert(indices.end(), face.begin(), face.end());
     }
-    for (auto& n : meshData->normals) {
-        float len = glm::length(n);
-        if (len > 1e-10f) n /= len; else n = glm::vec3(0, 1, 0);
+
+    // Recalculate Normals over the fan-split faces
+    if (!vertices.empty()) {
+        std::vector<unsigned int> tris;
+        triangulateFaces(vertsPerFace.data(), vertsPerFace.size(), indices.data(), 0, tris);
+        VertexFaceAdjacency adjacency;
+        buildVertexFaceAdjacency(tris.data(), tris.size() / 3, vertices.size(), adjacency);
+        computeSmoothNormals(glm::value_ptr(vertices.front()), 3, vertices.size(), tris.data(), tris.size() / 3,
+            adjacency, glm::value_ptr(normals.front()), 3);
     }
 
     return meshData;
@@ -3,33 +3,214 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <list>
 #include <memory>
 #include <filesystem>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string_view>
+#include <typeindex>
 
 #include <glm/glm.hpp>
 
+class MappedFile;
+
+// Contiguous array that either owns its elements or views memory kept alive elsewhere
+// (a mapped mesh cache). Read access never copies; Mutable() detaches a view into owned storage.
+template <typename T>
+class MeshArray {
+public:
+    MeshArray() = default;
+    MeshArray(std::vector<T> values) : owned(std::move(values)) {}
+    MeshArray& operator=(std::vector<T> values) {
+        owned = std::move(values);
+        viewData = nullptr;
+        viewCount = 0;
+        return *this;
+    }
+
+    void View(const T* data, size_t count) {
+        owned.clear();
+        owned.shrink_to_fit();
+        viewData = data;
+        viewCount = count;
+    }
+    bool IsView() const { return viewData != nullptr; }
+
+    std::vector<T>& Mutable() {
+        if (viewData) {
+            owned.assign(viewData, viewData + viewCount);
+            viewData = nullptr;
+            viewCount = 0;
+        }
+        return owned;
+    }
+
+    size_t size() const { return viewData ? viewCount : owned.size(); }
+    bool empty() const { return size() == 0; }
+    const T* data() const { return viewData ? viewData : owned.data(); }
+    const T& operator[](size_t i) const { return data()[i]; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+    // Heap bytes owned by this array; a view owns nothing
+    size_t MemoryBytes() const { return owned.capacity() * sizeof(T); }
+
+private:
+    std::vector<T> owned;
+    const T* viewData = nullptr;
+    size_t viewCount = 0;
+};
+
 struct MeshData {
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> uvs;
-    std::vector<unsigned int> indices;
-    std::vector<int> vertsPerFace;
+    MeshArray<glm::vec3> vertices;
+    MeshArray<glm::vec3> normals;
+    MeshArray<glm::vec2> uvs;
+    MeshArray<unsigned int> indices;
+    MeshArray<int> vertsPerFace;
+
+    std::shared_ptr<const MappedFile> backing; // set when the arrays view a mapped cache file
+
+    // Owned arrays plus the whole mapping they view, if any
+    size_t MemoryBytes() const;
+};
+
+// Identifies a product computed from a registered mesh, e.g. its subdivided geometry at one level.
+// kind (caller-defined codes) and variant (e.g. a triangle budget) tell apart products that share
+// name, scheme and level. Plain data, so building one and looking it up does not allocate: the name
+// is kept as a prefix plus a hash of the whole name.
+struct DerivedKey {
+    static constexpr size_t kNameChars = 31;
+
+    char name[kNameChars + 1] = {};
+    uint64_t nameHash = 0;
+    int scheme = 0;
+    int level = 0;
+    uint32_t kind = 0;
+    uint64_t variant = 0;
+
+    DerivedKey() = default;
+    DerivedKey(std::string_view name, int scheme, int level, uint32_t kind, uint64_t variant = 0);
+    bool operator==(const DerivedKey& other) const = default;
 };
 
+struct DerivedKeyHash {
+    size_t operator()(const DerivedKey& key) const;
+};
+
+// How a binary mesh cache entry is checked against its source file
+enum class MeshCacheValidation {
+    Timestamp, // source size and modification time
+    Hash,      // additionally a content hash of the source
+};
+
+// Thread-safe: any thread may register, get or prefetch. Each name is loaded at most once at a time;
+// concurrent requests for it share the same load.
 class ResourceManager {
 public:
+    // Resolves to the mesh, or nullptr when it is not registered or failed to load
+    using MeshHandle = std::shared_future<std::shared_ptr<MeshData>>;
+
     ResourceManager() = default;
+    // Waits for loads already running; queued ones are dropped
+    ~ResourceManager();
 	// Disable copy constructor and assignment operator
     ResourceManager(const ResourceManager&) = delete;
 	ResourceManager& operator=(const ResourceManager&) = delete;
 
     void RegisterResource(const std::string& name, const std::filesystem::path& path);
 
+    // Blocks until the mesh is available. A load queued by GetMeshAsync that has not started
+    // yet runs on the calling thread instead of waiting for a pool worker.
     [[nodiscard]] std::shared_ptr<MeshData> GetMesh(const std::string& name);
 
+    // Starts loading on the global thread pool and returns immediately
+    [[nodiscard]] MeshHandle GetMeshAsync(const std::string& name);
+
+    // GetMeshAsync for every registered resource, e.g. right after registration at startup
+    void PrefetchAll();
+
+    // Post-processed meshes are stored here as memory-mappable binaries; empty disables the cache.
+    // Set both before the first load.
+    void SetMeshCacheDirectory(const std::filesystem::path& dir) { meshCacheDir = dir; }
+    void SetMeshCacheValidation(MeshCacheValidation mode) { meshCacheValidation = mode; }
+    // .obj files use the built-in parallel parser unless disabled; Assimp reads everything else
+    void SetNativeObjParser(bool enabled) { useNativeObjParser = enabled; }
+
+    struct CacheStats {
+        size_t meshHits = 0;
+        size_t meshMisses = 0;
+        size_t derivedHits = 0;
+        size_t derivedMisses = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;        // meshes and derived products together
+        size_t pinnedBytes = 0;  // held outside the cache right now, so not evictable
+        size_t budget = 0;
+    };
+
+    // Byte budget for loaded meshes and derived products together (0: unlimited). Least recently
+    // used entries go first; entries still referenced outside the cache are pinned and skipped,
+    // so the total can stay above the budget while they are in use.
+    void SetMemoryBudget(size_t bytes);
+    size_t GetMemoryBudget() const;
+
+    // Derived products share the LRU and budget with the meshes; one larger than the whole budget
+    // is not stored. Find returns nullptr on a miss or when the stored product has a different type.
+    template <typename T>
+    void PutDerived(const DerivedKey& key, std::shared_ptr<const T> value, size_t bytes) {
+        PutDerivedErased(key, std::move(value), std::type_index(typeid(T)), bytes);
+    }
+    template <typename T>
+    [[nodiscard]] std::shared_ptr<const T> FindDerived(const DerivedKey& key) {
+        return std::static_pointer_cast<const T>(FindDerivedErased(key, std::type_index(typeid(T))));
+    }
+
+    CacheStats GetCacheStats() const;
+
 private:
-    std::shared_ptr<MeshData> LoadMeshFromFile(const std::filesystem::path& path);
+    struct PendingLoad {
+        std::atomic<bool> claimed{ false }; // whoever sets it first performs the load
+        std::promise<std::shared_ptr<MeshData>> promise;
+        MeshHandle future = promise.get_future().share();
+    };
+
+    // Looks up name under the lock: a cached mesh, an in-flight load, or a new pending load (nullptr if unregistered)
+    std::shared_ptr<PendingLoad> FindOrStartLoad(const std::string& name, std::shared_ptr<MeshData>& cached, bool& isNew);
+    void RunLoad(const std::string& name, const std::shared_ptr<PendingLoad>& pending);
+    std::shared_ptr<MeshData> LoadResource(const std::filesystem::path& relativePath);
+
+    struct CacheEntry {
+        std::string key; // mesh name; empty for derived products, which use derivedKey
+        DerivedKey derivedKey;
+        std::shared_ptr<const void> value;
+        std::type_index type = std::type_index(typeid(void));
+        size_t bytes = 0;
+        bool IsPinned() const { return value.use_count() > 1; }
+    };
+    // Both expect the lock to be held
+    void InsertEntry(CacheEntry entry);
+    void EraseEntry(const CacheEntry& entry); // the entry with the same key, if cached
+    void EvictToBudget();
+    void PutDerivedErased(const DerivedKey& key, std::shared_ptr<const void> value, std::type_index type, size_t bytes);
+    std::shared_ptr<const void> FindDerivedErased(const DerivedKey& key, std::type_index type);
+    std::shared_ptr<MeshData> LoadMeshFromFile(const std::filesystem::path& fullPath);
+    std::filesystem::path MeshCachePath(const std::filesystem::path& fullPath) const;
+
+    std::filesystem::path meshCacheDir = std::filesystem::path(PROJECT_ROOT_DIR) / ".meshcache";
+    MeshCacheValidation meshCacheValidation = MeshCacheValidation::Timestamp;
+    bool useNativeObjParser = true;
+
+    mutable std::mutex mutex; // guards everything below
 	std::unordered_map<std::string, std::filesystem::path> registeredResources;
-    std::unordered_map<std::string, std::shared_ptr<MeshData>> resourceCache;
+    std::list<CacheEntry> lru; // meshes (keyed by name) and derived products, most recently used first
+    std::unordered_map<std::string, std::list<CacheEntry>::iterator> resourceCache;
+    std::unordered_map<DerivedKey, std::list<CacheEntry>::iterator, DerivedKeyHash> derivedCache;
+    std::unordered_map<std::string, std::shared_ptr<PendingLoad>> pendingLoads;
+    size_t memoryBudget = 0;
+    size_t cachedBytes = 0;
+    CacheStats stats;
 };
 
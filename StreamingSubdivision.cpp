@@ -0,0 +1,205 @@
+#include "StreamingSubdivision.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <opensubdiv/far/primvarRefiner.h>
+
+#include "MeshPrimitives.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+struct LevelCounts {
+    size_t vertices = 0;
+    size_t edges = 0;
+    size_t faces = 0;
+    size_t faceVertices = 0; // sum of face sizes; also the face-edge, edge-face and vertex-face incidences
+};
+
+LevelCounts countLevel(const Far::TopologyLevel& level)
+{
+    return { (size_t)level.GetNumVertices(), (size_t)level.GetNumEdges(), (size_t)level.GetNumFaces(), (size_t)level.GetNumFaceVertices() };
+}
+
+// Vtr::Level keeps 4-byte indices, 2-byte local indices, count/offset pairs per component, sharpness and tags
+size_t topologyBytes(const LevelCounts& c)
+{
+    return c.faces * 9 + c.faceVertices * 20 + c.edges * 33 + c.vertices * 24;
+}
+
+// Parent -> child and child -> parent maps of one Vtr::Refinement
+size_t refinementBytes(const LevelCounts& parent, const LevelCounts& child)
+{
+    return 4 * (2 * parent.faceVertices + parent.faces + 3 * parent.edges + parent.vertices)
+        + 5 * (child.vertices + child.edges + child.faces);
+}
+
+// Counts after one uniform step: Loop splits triangles in four, the quad schemes split an n-gon into n quads
+LevelCounts predictNextLevel(const LevelCounts& c, Sdc::SchemeType scheme)
+{
+    LevelCounts next;
+    if (scheme == Sdc::SCHEME_LOOP) {
+        next.vertices = c.vertices + c.edges;
+        next.edges = 2 * c.edges + 3 * c.faces;
+        next.faces = 4 * c.faces;
+        next.faceVertices = 3 * next.faces;
+    }
+    else {
+        next.vertices = c.vertices + c.edges + c.faces;
+        next.edges = 2 * c.edges + c.faceVertices;
+        next.faces = c.faceVertices;
+        next.faceVertices = 4 * next.faces;
+    }
+    return next;
+}
+
+}
+
+size_t estimateTopologyLevelBytes(const Far::TopologyLevel& level)
+{
+    return topologyBytes(countLevel(level));
+}
+
+size_t estimateStreamingPeakBytes(const Far::TopologyLevel& base, Sdc::SchemeType scheme, int level)
+{
+    // Same per-stage predictions as the checks in streamSubdivision
+    LevelCounts prev = countLevel(base), current = prev;
+    size_t peak = current.vertices * sizeof(Vertex);
+    for (int l = 0; l < level; ++l) {
+        const LevelCounts next = predictNextLevel(current, scheme);
+        peak = std::max(peak, topologyBytes(current) + topologyBytes(next) + refinementBytes(current, next)
+            + (current.vertices + next.vertices) * sizeof(Vertex));
+        prev = current;
+        current = next;
+    }
+    if (level <= 0) return peak;
+
+    const size_t vertexBytes = current.vertices * sizeof(Vertex);
+    const size_t indexBytes = (current.faceVertices - 2 * current.faces) * 3 * sizeof(unsigned int);
+    peak = std::max(peak, topologyBytes(prev) + topologyBytes(current) + vertexBytes + indexBytes);
+    const size_t adjacencyBytes = (current.vertices + 1) * sizeof(unsigned int) + indexBytes;
+    const size_t faceNormalBytes = indexBytes;
+    return std::max(peak, vertexBytes + indexBytes + adjacencyBytes + faceNormalBytes);
+}
+
+bool streamSubdivision(const MeshData& mesh, Sdc::SchemeType scheme, int level, const StreamingOptions& options,
+    std::vector<Vertex>& verts, std::vector<unsigned int>& indices, StreamingStats* stats, const std::atomic<bool>* cancelled)
+{
+    verts.clear();
+    indices.clear();
+    if (stats) *stats = StreamingStats();
+
+    auto record = [&](std::string name, size_t topology, size_t vertex, size_t index) {
+        if (!stats) return;
+        StreamingStage stage{ std::move(name), topology, vertex, index };
+        stats->peakBytes = std::max(stats->peakBytes, stage.TotalBytes());
+        stats->stages.push_back(std::move(stage));
+    };
+    auto fitsBudget = [&](const char* stage, size_t bytes) {
+        if (options.memoryBudget == 0 || bytes <= options.memoryBudget) return true;
+        std::cerr << "[StreamingSubdivision] Error: " << stage << " needs ~" << bytes / (1024 * 1024) << " MB, budget is "
+                  << options.memoryBudget / (1024 * 1024) << " MB\n";
+        return false;
+    };
+
+    // Ping-pong buffers: src holds level l, dst receives level l + 1, then they swap
+    std::vector<Vertex> src, dst;
+    fillControlVertices(mesh, src);
+    if (level <= 0) {
+        // fillControlVertices leaves the normals zero; recompute them like every other level (and the
+        // tiled export) does
+        verts = std::move(src);
+        triangulateFaces(mesh.vertsPerFace.data(), mesh.vertsPerFace.size(), mesh.indices.data(), 0, indices);
+        recomputeNormals(verts, indices);
+        return true;
+    }
+
+    std::unique_ptr<Far::TopologyRefiner> refiner = createTopologyRefiner(mesh, scheme);
+    if (!refiner) {
+        std::cerr << "[StreamingSubdivision] Error: failed to create topology refiner\n";
+        return false;
+    }
+
+    for (int l = 0; l < level; ++l) {
+        if (cancelled && cancelled->load()) return false;
+
+        // From the second step on, continue from the last level of the previous single-step refiner.
+        // Its full topology is copied into the new base and released before refining.
+        if (l > 0) {
+            refiner = createTopologyRefiner(refiner->GetLevel(1), scheme);
+            if (!refiner) {
+                std::cerr << "[StreamingSubdivision] Error: failed to continue from level " << l << "\n";
+                return false;
+            }
+        }
+
+        const LevelCounts base = countLevel(refiner->GetLevel(0));
+        const LevelCounts next = predictNextLevel(base, scheme);
+        const size_t stepTopology = topologyBytes(base) + topologyBytes(next) + refinementBytes(base, next);
+        const size_t stepVertices = (base.vertices + next.vertices) * sizeof(Vertex);
+        const std::string stageName = "level " + std::to_string(l + 1);
+        if (!fitsBudget(stageName.c_str(), stepTopology + stepVertices)) return false;
+
+        {
+            TRACE_SCOPE("refine");
+            Far::TopologyRefiner::UniformOptions refineOptions(1);
+            refineOptions.fullTopologyInLastLevel = true;
+            refiner->RefineUniform(refineOptions);
+        }
+
+        const Far::TopologyLevel& refined = refiner->GetLevel(1);
+        // Grow dst in place when it is already large enough, otherwise drop it first so the old and
+        // new allocations never coexist
+        if (dst.capacity() < (size_t)refined.GetNumVertices()) std::vector<Vertex>().swap(dst);
+        dst.resize((size_t)refined.GetNumVertices());
+        if (dst.empty() || src.empty()) {
+            std::cerr << "[StreamingSubdivision] Error: level " << l + 1 << " has no vertices\n";
+            return false;
+        }
+        {
+            TRACE_SCOPE("interpolate");
+            Far::PrimvarRefiner primvarRefiner(*refiner);
+            const Vertex* srcData = src.data();
+            Vertex* dstData = dst.data();
+            primvarRefiner.Interpolate(1, srcData, dstData);
+        }
+
+        const LevelCounts actual = countLevel(refined);
+        record(stageName, topologyBytes(base) + topologyBytes(actual) + refinementBytes(base, actual),
+            (src.capacity() + dst.capacity()) * sizeof(Vertex), 0);
+        src.swap(dst);
+    }
+    // The second-to-last level is no longer needed by anything
+    std::vector<Vertex>().swap(dst);
+
+    const Far::TopologyLevel& lastLevel = refiner->GetLevel(1);
+    const LevelCounts last = countLevel(lastLevel);
+    const size_t lastTopology = topologyBytes(countLevel(refiner->GetLevel(0))) + topologyBytes(last);
+    const size_t vertexBytes = src.size() * sizeof(Vertex);
+    const size_t triangleBytes = (last.faceVertices - 2 * last.faces) * 3 * sizeof(unsigned int);
+    if (!fitsBudget("extract", lastTopology + vertexBytes + triangleBytes)) return false;
+    if (cancelled && cancelled->load()) return false;
+
+    extractTriangleIndices(lastLevel, 0, indices);
+    record("extract", lastTopology, src.capacity() * sizeof(Vertex), indices.capacity() * sizeof(unsigned int));
+    refiner.reset();
+
+    // The adjacency comes from the triangle list so the refiner is already gone during the gather.
+    // Budget: adjacency (offsets + one entry per corner) and the transient SoA face normals.
+    const size_t adjacencyBytes = (src.size() + 1 + indices.size()) * sizeof(unsigned int);
+    const size_t faceNormalBytes = indices.size() * sizeof(float);
+    if (!fitsBudget("normals", vertexBytes + indices.size() * sizeof(unsigned int) + adjacencyBytes + faceNormalBytes)) return false;
+    if (cancelled && cancelled->load()) return false;
+
+    VertexFaceAdjacency adjacency;
+    buildVertexFaceAdjacency(indices.data(), indices.size() / 3, src.size(), adjacency);
+    recomputeNormals(src, indices, adjacency, options.numThreads);
+    record("normals", 0, src.capacity() * sizeof(Vertex),
+        (indices.capacity() + adjacency.offsets.capacity() + adjacency.faces.capacity()) * sizeof(unsigned int));
+
+    verts = std::move(src);
+    return true;
+}
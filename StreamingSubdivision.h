@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include "Subdivision.h"
+
+struct StreamingOptions {
+    size_t memoryBudget = 0;     // bytes, 0: unlimited. Checked against the estimate before each step
+    unsigned int numThreads = 0; // normals; 0 uses every worker of the global pool
+};
+
+// Bytes alive while one stage ran. Topology bytes are estimated from the level's relation sizes.
+struct StreamingStage {
+    std::string name; // "level N", "extract", "normals"
+    size_t topologyBytes = 0;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t TotalBytes() const { return topologyBytes + vertexBytes + indexBytes; }
+};
+
+struct StreamingStats {
+    std::vector<StreamingStage> stages;
+    size_t peakBytes = 0;
+};
+
+// Estimated footprint of a refined level with full topology (all relations, tags and sharpness)
+size_t estimateTopologyLevelBytes(const OpenSubdiv::Far::TopologyLevel& level);
+
+// Peak bytes streamSubdivision will check against its budget when refining base to level, predicted
+// from the base counts alone (no refinement), e.g. to reserve memory before starting the job
+size_t estimateStreamingPeakBytes(const OpenSubdiv::Far::TopologyLevel& base, OpenSubdiv::Sdc::SchemeType scheme, int level);
+
+// Refines the cage to level one level at a time, keeping only two vertex buffers (ping-pong) and
+// the single-level refiner of the current step; earlier topology is released as soon as it has been
+// copied. verts/indices receive the last level only, ready to be moved into render state.
+// Fails before a step whose estimated peak exceeds options.memoryBudget, or when cancelled is raised.
+bool streamSubdivision(const MeshData& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, const StreamingOptions& options,
+    std::vector<Vertex>& verts, std::vector<unsigned int>& indices, StreamingStats* stats = nullptr,
+    const std::atomic<bool>* cancelled = nullptr);
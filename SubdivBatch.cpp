@@ -0,0 +1,476 @@
+// Headless batch farm: subdivides a directory or manifest of meshes to their target levels and
+// exports each result as binary PLY, without a window or GL context. Every asset runs as a chain of
+// load -> refine -> export tasks on a work-stealing pool; a global memory ceiling is reserved per
+// asset from the streaming estimate before it refines, and a JSON report gives per-asset timings
+// and sizes.
+//
+// Usage: SubdivBatch <directory|manifest.txt> [--level L] [--scheme auto|loop|catmark|bilinear]
+//                    [--threads N] [--memory-ceiling MB] [--out-dir dir] [--no-export]
+//                    [--report batch_report.json] [--mesh-cache] [--tile-triangles N]
+//
+// Manifest lines are "path [level] [scheme]", paths relative to the manifest; '#' starts a comment.
+// --tile-triangles switches to out-of-core export: each asset is refined and written tile by tile,
+// so levels whose output does not fit in memory can still be exported.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "MeshExport.h"
+#include "MeshPrimitives.h"
+#include "Metrics.h"
+#include "OutOfCoreExport.h"
+#include "ResourceManager.h"
+#include "StreamingSubdivision.h"
+#include "Subdivision.h"
+#include "WorkStealingPool.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+struct BatchConfig {
+    std::filesystem::path input;
+    int level = 3;                         // default for directory entries and manifest lines without one
+    std::optional<Sdc::SchemeType> scheme; // empty: Loop for triangle cages, Catmull-Clark otherwise
+    unsigned int threads = 0;              // pool workers, 0: all cores
+    size_t memoryCeiling = 0;              // bytes reserved across running assets; 0: unlimited
+    std::filesystem::path outDir = "batch_out";
+    bool exportMeshes = true;
+    bool useMeshCache = false;
+    size_t tileTriangles = 0;              // out-of-core export with tiles of this many triangles; 0: in memory
+    std::string reportPath = "batch_report.json";
+};
+
+struct BatchJob {
+    std::string name;
+    std::filesystem::path path;
+    int level = 0;
+    std::optional<Sdc::SchemeType> scheme;
+    uintmax_t fileBytes = 0;
+
+    // Filled in by the tasks; each stage runs after the previous one has finished
+    std::string status = "pending"; // ok, load_failed, over_ceiling, refine_failed, export_failed
+    Sdc::SchemeType usedScheme = Sdc::SCHEME_LOOP;
+    std::shared_ptr<MeshData> mesh;
+    std::vector<Vertex> verts;
+    std::vector<unsigned int> indices;
+    size_t baseVertices = 0;
+    size_t baseFaces = 0;
+    size_t outputVertices = 0;
+    size_t outputTriangles = 0;
+    size_t estimatedBytes = 0;
+    size_t peakBytes = 0; // largest streaming stage, or largest tile out of core
+    size_t tiles = 0;
+    size_t outputBytes = 0;
+    double loadMs = 0.0;
+    double waitMs = 0.0; // blocked on the memory ceiling
+    double refineMs = 0.0;
+    double exportMs = 0.0;
+    int worker = -1;     // ran the refine stage
+};
+
+// Bytes reserved by assets between refine and export. A reservation waits until it fits; one that
+// exceeds the whole ceiling is refused, so a waiting asset always has a chance once others finish.
+class MemoryCeiling {
+public:
+    explicit MemoryCeiling(size_t ceiling) : ceiling(ceiling) {}
+
+    bool Reserve(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (ceiling && bytes > ceiling) return false;
+        released.wait(lock, [&]() { return !ceiling || reserved + bytes <= ceiling; });
+        reserved += bytes;
+        peak = std::max(peak, reserved);
+        return true;
+    }
+
+    void Release(size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            reserved -= bytes;
+        }
+        released.notify_all();
+    }
+
+    size_t GetPeak() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return peak;
+    }
+
+private:
+    const size_t ceiling;
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    size_t reserved = 0;
+    size_t peak = 0;
+};
+
+bool parseArgs(int argc, char** argv, BatchConfig& config)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&](const char* flag) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << flag << "\n";
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (!std::strcmp(argv[i], "--level")) {
+            const char* v = next("--level"); if (!v) return false;
+            config.level = std::clamp(std::atoi(v), 0, 10);
+        }
+        else if (!std::strcmp(argv[i], "--scheme")) {
+            const char* v = next("--scheme"); if (!v) return false;
+            Sdc::SchemeType scheme;
+            if (std::strcmp(v, "auto") == 0) config.scheme.reset();
+            else if (parseScheme(v, scheme)) config.scheme = scheme;
+            else {
+                std::cerr << "Unknown scheme " << v << "\n";
+                return false;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--threads")) {
+            const char* v = next("--threads"); if (!v) return false;
+            config.threads = (unsigned int)std::max(0, std::atoi(v));
+        }
+        else if (!std::strcmp(argv[i], "--memory-ceiling")) {
+            const char* v = next("--memory-ceiling"); if (!v) return false;
+            config.memoryCeiling = (size_t)std::max(0ll, std::atoll(v)) << 20;
+        }
+        else if (!std::strcmp(argv[i], "--out-dir")) {
+            const char* v = next("--out-dir"); if (!v) return false;
+            config.outDir = v;
+        }
+        else if (!std::strcmp(argv[i], "--no-export")) {
+            config.exportMeshes = false;
+        }
+        else if (!std::strcmp(argv[i], "--mesh-cache")) {
+            config.useMeshCache = true;
+        }
+        else if (!std::strcmp(argv[i], "--tile-triangles")) {
+            const char* v = next("--tile-triangles"); if (!v) return false;
+            config.tileTriangles = (size_t)std::max(0ll, std::atoll(v));
+        }
+        else if (!std::strcmp(argv[i], "--report")) {
+            const char* v = next("--report"); if (!v) return false;
+            config.reportPath = v;
+        }
+        else if (argv[i][0] != '-' && config.input.empty()) {
+            config.input = argv[i];
+        }
+        else {
+            config.input.clear();
+            break;
+        }
+    }
+    if (config.input.empty()) {
+        std::cerr << "Usage: SubdivBatch <directory|manifest.txt> [--level L] [--scheme auto|loop|catmark|bilinear]"
+                     " [--threads N] [--memory-ceiling MB] [--out-dir dir] [--no-export] [--report batch_report.json]"
+                     " [--mesh-cache] [--tile-triangles N]\n";
+        return false;
+    }
+    if (config.tileTriangles && !config.exportMeshes) {
+        std::cerr << "--tile-triangles refines while writing and cannot be combined with --no-export\n";
+        return false;
+    }
+    return true;
+}
+
+bool isMeshFile(const std::filesystem::path& path)
+{
+    static const char* const kExtensions[] = { ".obj", ".ply", ".stl", ".off", ".fbx", ".dae", ".3ds", ".gltf", ".glb" };
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return std::find_if(std::begin(kExtensions), std::end(kExtensions), [&](const char* e) { return ext == e; }) != std::end(kExtensions);
+}
+
+bool collectJobs(const BatchConfig& config, std::vector<BatchJob>& jobs)
+{
+    std::error_code ec;
+    if (std::filesystem::is_directory(config.input, ec)) {
+        for (const auto& entry : std::filesystem::directory_iterator(config.input, ec)) {
+            if (!entry.is_regular_file() || !isMeshFile(entry.path())) continue;
+            BatchJob job;
+            job.path = entry.path();
+            job.level = config.level;
+            jobs.push_back(std::move(job));
+        }
+        // Directory order is unspecified; keep reports comparable between runs
+        std::sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) { return a.path < b.path; });
+    }
+    else {
+        std::ifstream manifest(config.input);
+        if (!manifest) {
+            std::cerr << "[SubdivBatch] Error: cannot open " << config.input.string() << "\n";
+            return false;
+        }
+        const std::filesystem::path baseDir = config.input.parent_path();
+        std::string line;
+        for (int lineNumber = 1; std::getline(manifest, line); ++lineNumber) {
+            if (size_t hash = line.find('#'); hash != std::string::npos) line.resize(hash);
+            std::istringstream fields(line);
+            std::string path, levelField, schemeField;
+            if (!(fields >> path)) continue;
+            BatchJob job;
+            job.path = baseDir / path;
+            job.level = config.level;
+            if (fields >> levelField) job.level = std::clamp(std::atoi(levelField.c_str()), 0, 10);
+            if (fields >> schemeField && schemeField != "auto") {
+                Sdc::SchemeType scheme;
+                if (!parseScheme(schemeField.c_str(), scheme)) {
+                    std::cerr << "[SubdivBatch] " << config.input.string() << ":" << lineNumber << ": unknown scheme " << schemeField << "\n";
+                    return false;
+                }
+                job.scheme = scheme;
+            }
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    // Names label the report and the exported files, so repeated stems get a suffix
+    std::vector<std::string> used;
+    for (BatchJob& job : jobs) {
+        if (!job.scheme) job.scheme = config.scheme;
+        std::string name = job.path.stem().string() + "_l" + std::to_string(job.level);
+        for (int n = 2; std::find(used.begin(), used.end(), name) != used.end(); ++n)
+            name = job.path.stem().string() + "_" + std::to_string(n) + "_l" + std::to_string(job.level);
+        used.push_back(name);
+        job.name = name;
+        job.fileBytes = std::filesystem::file_size(job.path, ec);
+        if (ec) job.fileBytes = 0;
+    }
+    return true;
+}
+
+void writeReport(std::ostream& out, const BatchConfig& config, const std::vector<BatchJob>& jobs, double wallMs,
+    unsigned int threads, size_t peakReserved, const WorkStealingPool::Stats& poolStats)
+{
+    out << "{\n";
+    out << "  \"threads\": " << threads << ",\n";
+    out << "  \"memory_ceiling_bytes\": " << config.memoryCeiling << ",\n";
+    out << "  \"peak_reserved_bytes\": " << peakReserved << ",\n";
+    out << "  \"peak_rss_bytes\": " << peakResidentBytes() << ",\n";
+    out << "  \"wall_ms\": " << wallMs << ",\n";
+    out << "  \"tasks\": " << poolStats.executed << ", \"stolen\": " << poolStats.stolen << ",\n";
+    out << "  \"assets\": [\n";
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const BatchJob& job = jobs[i];
+        out << "    {\"name\": \"" << job.name << "\", \"path\": \"" << job.path.generic_string() << "\""
+            << ", \"level\": " << job.level << ", \"scheme\": \"" << schemeName(job.usedScheme) << "\""
+            << ", \"status\": \"" << job.status << "\",\n";
+        out << "     \"base_vertices\": " << job.baseVertices << ", \"base_faces\": " << job.baseFaces
+            << ", \"vertices\": " << job.outputVertices << ", \"triangles\": " << job.outputTriangles << ",\n";
+        out << "     \"estimated_peak_bytes\": " << job.estimatedBytes << ", \"peak_bytes\": " << job.peakBytes
+            << ", \"tiles\": " << job.tiles << ", \"output_bytes\": " << job.outputBytes << ",\n";
+        out << "     \"load_ms\": " << job.loadMs << ", \"wait_ms\": " << job.waitMs << ", \"refine_ms\": " << job.refineMs
+            << ", \"export_ms\": " << job.exportMs << ", \"worker\": " << job.worker << "}"
+            << (i + 1 < jobs.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+// One asset's task chain. Each stage submits the next from its worker, which lands on the back of
+// that worker's own deque and is popped next, so an asset holding a reservation is never queued
+// behind assets still waiting for one.
+class BatchRunner {
+public:
+    BatchRunner(const BatchConfig& config, WorkStealingPool& pool, MemoryCeiling& ceiling)
+        : config(config), pool(pool), ceiling(ceiling) {}
+
+    void Load(BatchJob& job)
+    {
+        Stopwatch sw;
+        ResourceManager resMgr;
+        if (!config.useMeshCache) resMgr.SetMeshCacheDirectory({});
+        resMgr.RegisterResource(job.name, std::filesystem::absolute(job.path));
+        job.mesh = resMgr.GetMesh(job.name);
+        if (!job.mesh) {
+            job.status = "load_failed";
+            Finish(job, 0);
+            return;
+        }
+        job.baseVertices = job.mesh->vertices.size();
+        job.baseFaces = job.mesh->vertsPerFace.size();
+
+        // Loop only takes triangles, so a polygonal cage is split first
+        job.usedScheme = job.scheme ? *job.scheme : defaultScheme(*job.mesh);
+        if (job.usedScheme == Sdc::SCHEME_LOOP && !isTriangleMesh(*job.mesh)) job.mesh = triangulateMesh(*job.mesh);
+        auto refiner = createTopologyRefiner(*job.mesh, job.usedScheme);
+        if (refiner && config.tileTriangles)
+            job.estimatedBytes = estimateOutOfCoreExportBytes(refiner->GetLevel(0), job.usedScheme, job.level, TileOptions());
+        else if (refiner)
+            job.estimatedBytes = estimateStreamingPeakBytes(refiner->GetLevel(0), job.usedScheme, job.level);
+        job.loadMs = sw.ElapsedMs();
+
+        pool.Submit([this, &job]() { Refine(job); });
+    }
+
+    void Refine(BatchJob& job)
+    {
+        Stopwatch sw;
+        if (!ceiling.Reserve(job.estimatedBytes)) {
+            job.status = "over_ceiling";
+            job.mesh.reset();
+            Finish(job, 0);
+            return;
+        }
+        job.waitMs = sw.ElapsedMs();
+        job.worker = pool.CurrentWorker();
+        if (config.tileTriangles) {
+            ExportTiled(job);
+            return;
+        }
+
+        // One worker per asset: the pool's parallelism comes from running assets side by side
+        sw.Reset();
+        StreamingOptions options;
+        options.memoryBudget = config.memoryCeiling;
+        options.numThreads = 1;
+        StreamingStats stats;
+        const bool refined = streamSubdivision(*job.mesh, job.usedScheme, job.level, options, job.verts, job.indices, &stats);
+        job.refineMs = sw.ElapsedMs();
+        job.peakBytes = stats.peakBytes;
+        job.mesh.reset();
+        if (!refined) {
+            job.status = "refine_failed";
+            Finish(job, job.estimatedBytes);
+            return;
+        }
+        job.outputVertices = job.verts.size();
+        job.outputTriangles = job.indices.size() / 3;
+
+        pool.Submit([this, &job]() { Export(job); });
+    }
+
+    void Export(BatchJob& job)
+    {
+        Stopwatch sw;
+        bool written = true;
+        if (config.exportMeshes)
+            written = writePly((config.outDir / (job.name + ".ply")).string(), job.verts, job.indices, &job.outputBytes);
+        job.exportMs = sw.ElapsedMs();
+        job.status = written ? "ok" : "export_failed";
+        Finish(job, job.estimatedBytes);
+    }
+
+private:
+    OutOfCoreExportOptions TileOptions() const
+    {
+        OutOfCoreExportOptions options;
+        options.tileTriangles = config.tileTriangles;
+        options.numThreads = 1;
+        return options;
+    }
+
+    // Refine and write in one stage, tile by tile; refine_ms covers both
+    void ExportTiled(BatchJob& job)
+    {
+        Stopwatch sw;
+        OutOfCoreExportStats stats;
+        const bool written = exportSubdividedPly(*job.mesh, job.usedScheme, job.level, (config.outDir / (job.name + ".ply")).string(), TileOptions(), &stats);
+        job.refineMs = sw.ElapsedMs();
+        job.mesh.reset();
+        job.status = written ? "ok" : "export_failed";
+        job.outputVertices = stats.vertices;
+        job.outputTriangles = stats.triangles;
+        job.outputBytes = stats.bytesWritten;
+        job.peakBytes = stats.peakTileBytes;
+        job.tiles = stats.tiles;
+        Finish(job, job.estimatedBytes);
+    }
+
+    void Finish(BatchJob& job, size_t reservedBytes)
+    {
+        std::vector<Vertex>().swap(job.verts);
+        std::vector<unsigned int>().swap(job.indices);
+        if (reservedBytes) ceiling.Release(reservedBytes);
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cerr << "[SubdivBatch] " << job.name << ": " << job.status << ", " << job.outputTriangles << " tris, refine "
+                  << job.refineMs << " ms, export " << job.exportMs << " ms\n";
+    }
+
+    const BatchConfig& config;
+    WorkStealingPool& pool;
+    MemoryCeiling& ceiling;
+    std::mutex logMutex;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BatchConfig config;
+    if (!parseArgs(argc, argv, config)) return EXIT_FAILURE;
+
+    std::vector<BatchJob> jobs;
+    if (!collectJobs(config, jobs)) return EXIT_FAILURE;
+    if (jobs.empty()) {
+        std::cerr << "[SubdivBatch] No meshes found in " << config.input.string() << "\n";
+        return EXIT_FAILURE;
+    }
+    if (config.exportMeshes) {
+        std::error_code ec;
+        std::filesystem::create_directories(config.outDir, ec);
+        if (ec) {
+            std::cerr << "[SubdivBatch] Error: cannot create " << config.outDir.string() << ": " << ec.message() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Largest first (file size grows with the cage, output with 4^level), so a long asset does not
+    // start last and leave the other workers idle at the end
+    std::vector<BatchJob*> order;
+    for (BatchJob& job : jobs) order.push_back(&job);
+    std::stable_sort(order.begin(), order.end(), [](const BatchJob* a, const BatchJob* b) {
+        return (double)a->fileBytes * (double)(1ull << (2 * a->level)) > (double)b->fileBytes * (double)(1ull << (2 * b->level));
+    });
+
+    Stopwatch wall;
+    MemoryCeiling ceiling(config.memoryCeiling);
+    WorkStealingPool::Stats poolStats;
+    unsigned int threads = 0;
+    {
+        WorkStealingPool pool(config.threads);
+        threads = pool.GetThreadCount();
+        BatchRunner runner(config, pool, ceiling);
+        for (BatchJob* job : order) pool.Submit([&runner, job]() { runner.Load(*job); });
+        pool.WaitIdle();
+        poolStats = pool.GetStats();
+    }
+    const double wallMs = wall.ElapsedMs();
+
+    size_t failed = 0;
+    for (const BatchJob& job : jobs) failed += job.status != "ok";
+    std::cerr << "[SubdivBatch] " << jobs.size() - failed << "/" << jobs.size() << " assets in " << wallMs << " ms on "
+              << threads << " workers (" << poolStats.stolen << " tasks stolen)\n";
+
+    if (config.reportPath == "-") {
+        writeReport(std::cout, config, jobs, wallMs, threads, ceiling.GetPeak(), poolStats);
+    }
+    else {
+        std::ofstream out(config.reportPath);
+        if (!out) {
+            std::cerr << "[SubdivBatch] Error: cannot write " << config.reportPath << "\n";
+            return EXIT_FAILURE;
+        }
+        writeReport(out, config, jobs, wallMs, threads, ceiling.GetPeak(), poolStats);
+        std::cerr << "[SubdivBatch] Wrote " << config.reportPath << "\n";
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,868 @@
+// Headless subdivision benchmark: runs the viewer's assets through every pipeline stage
+// and writes min/median/p99 timings per stage as JSON, so runs can be diffed between commits.
+//
+// Usage: SubdivBench [--reps N] [--min-level L] [--max-level L] [--threads N] [--mesh-cache]
+//                    [--assimp-obj] [--isolation L] [--adaptive-budget N] [--memory-budget MB] [--out file.json]
+//                    [--trace trace.json] [--scheme auto|loop|catmark|bilinear] [--anim-frames N] [--instances N]
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opensubdiv/far/primvarRefiner.h>
+
+#include "AdaptiveSubdivision.h"
+#include "AllocationCounter.h"
+#include "AnimatedSubdivision.h"
+#include "IncrementalSubdivision.h"
+#include "LimitSurface.h"
+#include "Meshlets.h"
+#include "Metrics.h"
+#include "MeshPrimitives.h"
+#include "ObjParser.h"
+#include "PrimvarChannels.h"
+#include "StreamingSubdivision.h"
+#include "ResourceManager.h"
+#include "Subdivision.h"
+#include "SubdivisionArena.h"
+#include "SubdivisionCache.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "VertexCache.h"
+#include "VertexPacking.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+struct BenchConfig {
+    int repetitions = 5;
+    int minLevel = 1;
+    int maxLevel = 5;
+    unsigned int threads = 0;  // stencil evaluation workers, 0: all cores
+    bool useMeshCache = false; // measure mapped cache loads instead of OBJ parsing
+    bool assimpObj = false;    // parse OBJ with Assimp instead of the native parser
+    int isolationLevel = 3;            // adaptive mode; 0 skips it
+    size_t adaptiveBudget = 1000000;   // adaptive triangle budget
+    size_t memoryBudget = 0;           // streaming mode, bytes; 0: unlimited
+    std::string outPath = "subdiv_bench.json";
+    std::string tracePath;             // Chrome trace of the library's TRACE_SCOPE spans; empty: off
+    std::optional<Sdc::SchemeType> scheme; // empty: Loop for triangle cages, Catmull-Clark otherwise
+    int animationFrames = 60;          // deformed frames per repetition; 0 skips the animation pass
+    int instances = 4;                 // copies of each cage at the max level sharing one topology; 0 skips it
+};
+
+struct BenchAsset {
+    std::string name;
+    std::string path; // empty for the procedural cube
+};
+
+const char* const kStages[] = { "refine", "stencils", "interpolate", "interpolate_serial", "interpolate_aos",
+    "interpolate_refiner", "interpolate_refiner_aos", "extract", "normals",
+    "limit_masks", "limit", "step", "streaming", "meshlets", "vertex_cache", "vertex_fetch", "refine_triangulated", "animate", "pack", "pack_reference", "total" };
+
+struct LevelResult {
+    int level = 0;
+    size_t vertices = 0;
+    size_t faces = 0;              // refined faces before the fan split
+    size_t triangles = 0;
+    size_t triangulatedFaces = 0;  // same level from the triangulated cage under Loop; 0 when not compared
+    bool parallelBitIdentical = true;
+    unsigned int channels = PRIMVAR_POSITION; // primvar channels blended by the interpolate stages
+    bool channelsBitIdentical = true;         // channel-specialized passes against the full Vertex ones
+    bool streamingWithinBudget = true;
+    StreamingStats streaming; // bytes per stage of the last streaming run
+    VertexCacheStats cacheBefore, cacheAfter; // refiner order vs. optimized order
+    size_t meshlets = 0;
+    size_t meshletBytes = 0;
+    bool packBitIdentical = true; // SIMD encoder against the scalar reference
+    VertexPackingError packError;
+    std::map<std::string, std::vector<double>> samples;
+};
+
+struct AdaptiveResult {
+    bool valid = false;
+    size_t regularPatches = 0;
+    size_t irregularPatches = 0;
+    size_t vertices = 0;
+    size_t triangles = 0;
+    float rateScale = 1.0f;
+    std::map<std::string, std::vector<double>> samples; // build, points, tessellate
+};
+
+// Level changes on cached topologies through the arena, the way the viewer's worker runs them
+struct SteadyStateResult {
+    bool valid = false;
+    int passes = 0;              // measured passes up and down the levels, after one warm-up pass per repetition
+    size_t levelChanges = 0;     // measured
+    AllocationCounts warmup;     // warm-up passes: arena scratch and output buffers grow here
+    AllocationCounts steady;     // measured passes; zero when the path is allocation-free
+    size_t arenaBytes = 0;
+    std::vector<double> samples; // ms per measured level change
+};
+
+// Copies of one cage with their own positions through one cache, against a topology built per copy
+struct InstanceResult {
+    bool valid = false;
+    int level = 0;
+    size_t instances = 0;
+    SubdivisionCache::Stats stats; // shared run
+    std::map<std::string, std::vector<double>> samples; // shared, per_instance
+};
+
+struct AssetResult {
+    std::string name;
+    size_t baseVertices = 0;
+    size_t baseFaces = 0;
+    size_t baseTriangles = 0; // faces after a fan split of the cage
+    Sdc::SchemeType scheme = Sdc::SCHEME_LOOP;
+    std::vector<double> loadSamples;
+    std::vector<LevelResult> levels;
+    AdaptiveResult adaptive;
+    SteadyStateResult steadyState;
+    InstanceResult instances;
+    uint64_t peakRssAfter = 0;
+};
+
+bool parseArgs(int argc, char** argv, BenchConfig& config)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&](const char* flag) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << flag << "\n";
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (!std::strcmp(argv[i], "--reps")) {
+            const char* v = next("--reps"); if (!v) return false;
+            config.repetitions = std::max(1, std::atoi(v));
+        }
+        else if (!std::strcmp(argv[i], "--min-level")) {
+            const char* v = next("--min-level"); if (!v) return false;
+            config.minLevel = std::max(1, std::atoi(v));
+        }
+        else if (!std::strcmp(argv[i], "--max-level")) {
+            const char* v = next("--max-level"); if (!v) return false;
+            config.maxLevel = std::atoi(v);
+        }
+        else if (!std::strcmp(argv[i], "--threads")) {
+            const char* v = next("--threads"); if (!v) return false;
+            config.threads = (unsigned int)std::max(0, std::atoi(v));
+        }
+        else if (!std::strcmp(argv[i], "--mesh-cache")) {
+            config.useMeshCache = true;
+        }
+        else if (!std::strcmp(argv[i], "--assimp-obj")) {
+            config.assimpObj = true;
+        }
+        else if (!std::strcmp(argv[i], "--isolation")) {
+            const char* v = next("--isolation"); if (!v) return false;
+            config.isolationLevel = std::clamp(std::atoi(v), 0, 10);
+        }
+        else if (!std::strcmp(argv[i], "--adaptive-budget")) {
+            const char* v = next("--adaptive-budget"); if (!v) return false;
+            config.adaptiveBudget = (size_t)std::max(1ll, std::atoll(v));
+        }
+        else if (!std::strcmp(argv[i], "--memory-budget")) {
+            const char* v = next("--memory-budget"); if (!v) return false;
+            config.memoryBudget = (size_t)std::max(0ll, std::atoll(v)) << 20;
+        }
+        else if (!std::strcmp(argv[i], "--out")) {
+            const char* v = next("--out"); if (!v) return false;
+            config.outPath = v;
+        }
+        else if (!std::strcmp(argv[i], "--scheme")) {
+            const char* v = next("--scheme"); if (!v) return false;
+            Sdc::SchemeType scheme;
+            if (std::strcmp(v, "auto") == 0) config.scheme.reset();
+            else if (parseScheme(v, scheme)) config.scheme = scheme;
+            else {
+                std::cerr << "Unknown scheme " << v << "\n";
+                return false;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--instances")) {
+            const char* v = next("--instances"); if (!v) return false;
+            config.instances = std::max(0, std::atoi(v));
+        }
+        else if (!std::strcmp(argv[i], "--anim-frames")) {
+            const char* v = next("--anim-frames"); if (!v) return false;
+            config.animationFrames = std::max(0, std::atoi(v));
+        }
+        else if (!std::strcmp(argv[i], "--trace")) {
+            const char* v = next("--trace"); if (!v) return false;
+            config.tracePath = v;
+        }
+        else {
+            std::cerr << "Usage: SubdivBench [--reps N] [--min-level L] [--max-level L] [--threads N] [--mesh-cache]"
+                         " [--assimp-obj] [--isolation L] [--adaptive-budget N] [--memory-budget MB] [--out file.json]"
+                         " [--trace trace.json] [--scheme auto|loop|catmark|bilinear] [--anim-frames N] [--instances N]\n";
+            return false;
+        }
+    }
+    return config.maxLevel >= config.minLevel;
+}
+
+std::shared_ptr<MeshData> loadAsset(const BenchAsset& asset, const BenchConfig& config)
+{
+    std::shared_ptr<MeshData> mesh;
+    if (asset.path.empty()) {
+        createCube(mesh);
+        return mesh;
+    }
+
+    ResourceManager resMgr;
+    if (!config.useMeshCache) resMgr.SetMeshCacheDirectory({});
+    resMgr.SetNativeObjParser(!config.assimpObj);
+    resMgr.RegisterResource(asset.name, asset.path);
+    return resMgr.GetMesh(asset.name);
+}
+
+// The native OBJ parser must give the same corners however the text is chunked. The synthetic file
+// mixes absolute indices with relative ones reaching back thousands of positions, so with 4 KB
+// chunks many of them point into an earlier chunk.
+bool checkObjChunking()
+{
+    std::string text;
+    const int kPositions = 20000;
+    for (int i = 0; i < kPositions; ++i) {
+        text += "v " + std::to_string(i) + " " + std::to_string(i % 97) + " 0\n";
+        if (i >= 3000 && i % 7 == 0) text += "f -1 -" + std::to_string(2 + i % 13) + " -" + std::to_string(3000) + "\n";
+        if (i >= 3 && i % 11 == 0) text += "f " + std::to_string(i) + "/1 " + std::to_string(i - 1) + "//2 " + std::to_string(i / 2 + 1) + "\n";
+    }
+
+    std::vector<glm::vec3> oneChunk, manyChunks;
+    std::vector<int> oneSizes, manySizes;
+    ObjParseStats stats;
+    if (!parseObjCorners(text.data(), text.size(), oneChunk, oneSizes, nullptr, 1, text.size())) return false;
+    if (!parseObjCorners(text.data(), text.size(), manyChunks, manySizes, &stats, 8, 4096)) return false;
+    return stats.chunks > 1 && oneSizes == manySizes && oneChunk.size() == manyChunks.size()
+        && std::memcmp(oneChunk.data(), manyChunks.data(), oneChunk.size() * sizeof(glm::vec3)) == 0;
+}
+
+void runLevel(const std::shared_ptr<MeshData>& meshPtr, Sdc::SchemeType scheme, int level, const BenchConfig& config, LevelResult& result)
+{
+    const MeshData& mesh = *meshPtr;
+    Stopwatch sw;
+
+    auto refiner = createTopologyRefiner(mesh, scheme);
+    Far::TopologyRefiner::UniformOptions refineOptions(level);
+    refineOptions.fullTopologyInLastLevel = true;
+    refiner->RefineUniform(refineOptions);
+    result.samples["refine"].push_back(sw.ElapsedMs());
+
+    sw.Reset();
+    auto stencils = createLastLevelStencils(*refiner);
+    result.samples["stencils"].push_back(sw.ElapsedMs());
+
+    // Channel-specialized stencil pass as the viewer runs it, including the load into channel rows
+    sw.Reset();
+    std::vector<Vertex> controlVerts;
+    fillControlVertices(mesh, controlVerts);
+    result.channels = primvarChannelsFor(mesh);
+    PrimvarBuffer controlChannels;
+    controlChannels.Load(controlVerts.data(), controlVerts.size(), result.channels);
+    std::vector<Vertex> verts(stencils->GetNumStencils());
+    evaluateStencilChannels(*stencils, controlChannels, verts.data(), config.threads);
+    result.samples["interpolate"].push_back(sw.ElapsedMs());
+
+    // Serial reference, excluded from the total; the parallel result must match it bit for bit
+    sw.Reset();
+    std::vector<Vertex> serialVerts(verts.size());
+    evaluateStencilChannels(*stencils, controlChannels, serialVerts.data(), 1);
+    result.samples["interpolate_serial"].push_back(sw.ElapsedMs());
+    if (!verts.empty() && std::memcmp(verts.data(), serialVerts.data(), verts.size() * sizeof(Vertex)) != 0)
+        result.parallelBitIdentical = false;
+
+    // Full Vertex struct through the same stencils, excluded from the total. Control normals are zero
+    // and skipped uvs are all zero, so the skipped channels match too and the whole vertex must agree.
+    sw.Reset();
+    std::vector<Vertex> aosVerts(verts.size());
+    evaluateStencils(*stencils, controlVerts.data(), aosVerts.data(), config.threads);
+    result.samples["interpolate_aos"].push_back(sw.ElapsedMs());
+    if (!verts.empty() && std::memcmp(verts.data(), aosVerts.data(), verts.size() * sizeof(Vertex)) != 0)
+        result.channelsBitIdentical = false;
+
+    // Level-by-level PrimvarRefiner path (what incremental stepping uses), excluded from the total
+    sw.Reset();
+    interpolatePrimvarChannels(*refiner, 0, level, controlVerts.data(), serialVerts.data(), result.channels);
+    result.samples["interpolate_refiner"].push_back(sw.ElapsedMs());
+    sw.Reset();
+    {
+        Far::PrimvarRefiner primvarRefiner(*refiner);
+        std::vector<Vertex> src = controlVerts, dst;
+        for (int l = 1; l <= level; ++l) {
+            dst.resize((size_t)refiner->GetLevel(l).GetNumVertices());
+            const Vertex* s = src.data();
+            Vertex* d = dst.data();
+            primvarRefiner.Interpolate(l, s, d);
+            src.swap(dst);
+        }
+        aosVerts.swap(src);
+    }
+    result.samples["interpolate_refiner_aos"].push_back(sw.ElapsedMs());
+    if (!aosVerts.empty() && std::memcmp(serialVerts.data(), aosVerts.data(), aosVerts.size() * sizeof(Vertex)) != 0)
+        result.channelsBitIdentical = false;
+    serialVerts = std::vector<Vertex>();
+    aosVerts = std::vector<Vertex>();
+
+    sw.Reset();
+    std::vector<unsigned int> indices;
+    VertexFaceAdjacency adjacency;
+    extractTriangleIndices(refiner->GetLevel(level), 0, indices);
+    if (!buildVertexFaceAdjacency(refiner->GetLevel(level), adjacency))
+        buildVertexFaceAdjacency(indices.data(), indices.size() / 3, verts.size(), adjacency);
+    result.samples["extract"].push_back(sw.ElapsedMs());
+
+    sw.Reset();
+    recomputeNormals(verts, indices, adjacency, config.threads);
+    result.samples["normals"].push_back(sw.ElapsedMs());
+
+    // Limit surface path, excluded from the total: one-time mask build, then the per-update limit pass
+    sw.Reset();
+    LimitMasks limitMasks;
+    bool haveLimit = buildLimitMasks(*refiner, limitMasks);
+    result.samples["limit_masks"].push_back(sw.ElapsedMs());
+
+    if (haveLimit) {
+        sw.Reset();
+        std::vector<Vertex> limitVerts(verts.size());
+        evaluateLimit(limitMasks, verts.data(), limitVerts.data(), config.threads);
+        result.samples["limit"].push_back(sw.ElapsedMs());
+    }
+
+    // Incremental stepping, excluded from the total: level - 1 is retained, only the new level is refined
+    IncrementalSubdivision incremental(meshPtr, scheme);
+    if (level == 1 || incremental.GetLevel(level - 1)) {
+        sw.Reset();
+        incremental.GetLevel(level);
+        result.samples["step"].push_back(sw.ElapsedMs());
+    }
+
+    // Streaming refinement, excluded from the total: two live levels, bytes recorded per stage
+    sw.Reset();
+    StreamingOptions streamingOptions;
+    streamingOptions.memoryBudget = config.memoryBudget;
+    streamingOptions.numThreads = config.threads;
+    std::vector<Vertex> streamedVerts;
+    std::vector<unsigned int> streamedIndices;
+    if (streamSubdivision(mesh, scheme, level, streamingOptions, streamedVerts, streamedIndices, &result.streaming))
+        result.samples["streaming"].push_back(sw.ElapsedMs());
+    else
+        result.streamingWithinBudget = false;
+
+    // Meshlets grouped by base face, excluded from the total; needs the refiner's triangle order
+    sw.Reset();
+    std::vector<unsigned int> triangleGroups;
+    buildBaseFaceGroups(*refiner, triangleGroups);
+    MeshletBuffers meshlets;
+    if (buildMeshlets(verts, indices, triangleGroups, MeshletOptions(), meshlets, config.threads)) {
+        result.samples["meshlets"].push_back(sw.ElapsedMs());
+        result.meshlets = meshlets.meshlets.size();
+        result.meshletBytes = meshlets.MemoryBytes();
+    }
+    meshlets = MeshletBuffers();
+
+    // Draw order optimization, excluded from the total (the viewer can turn it off)
+    result.cacheBefore = simulateVertexCache(indices, verts.size());
+    sw.Reset();
+    optimizeVertexCache(indices, verts.size());
+    result.samples["vertex_cache"].push_back(sw.ElapsedMs());
+    sw.Reset();
+    optimizeVertexFetch(verts, indices);
+    result.samples["vertex_fetch"].push_back(sw.ElapsedMs());
+    result.cacheAfter = simulateVertexCache(indices, verts.size());
+
+    // Packed 16-byte upload layout, excluded from the total: bounds plus the SIMD encoder, then the
+    // scalar reference it must match bit for bit, then the round-trip error
+    sw.Reset();
+    VertexPackingBounds packingBounds = computePackingBounds(verts.data(), verts.size(), config.threads);
+    std::vector<PackedVertex> packed(verts.size());
+    packVertices(verts.data(), verts.size(), packingBounds, packed.data(), config.threads);
+    result.samples["pack"].push_back(sw.ElapsedMs());
+    sw.Reset();
+    std::vector<PackedVertex> packedReference(verts.size());
+    packVerticesReference(verts.data(), verts.size(), packingBounds, packedReference.data());
+    result.samples["pack_reference"].push_back(sw.ElapsedMs());
+    if (!packed.empty() && std::memcmp(packed.data(), packedReference.data(), packed.size() * sizeof(PackedVertex)) != 0)
+        result.packBitIdentical = false;
+    result.packError = measurePackingError(verts.data(), packed.data(), verts.size(), packingBounds);
+
+    double totalMs = 0.0;
+    for (const char* stage : { "refine", "stencils", "interpolate", "extract", "normals" }) totalMs += result.samples[stage].back();
+    result.samples["total"].push_back(totalMs);
+    result.vertices = verts.size();
+    result.faces = (size_t)refiner->GetLevel(level).GetNumFaces();
+    result.triangles = indices.size() / 3;
+}
+
+// Per-frame cost of a deforming cage, excluded from the total: topology and stencils are built once,
+// each frame rewrites the cage, runs the stencils and recomputes normals in place. The viewer adds
+// a glBufferSubData of the result on top, which a headless run cannot time.
+void runAnimation(const std::shared_ptr<MeshData>& meshPtr, Sdc::SchemeType scheme, int level, const BenchConfig& config, LevelResult& result)
+{
+    if (config.animationFrames <= 0) return;
+    SubdivisionCache cache;
+    auto topology = cache.Acquire(meshPtr, scheme, level);
+    if (!topology) return;
+
+    AnimatedSubdivision animated(meshPtr, topology, config.threads);
+    CageDeformer deformer = makeWaveDeformer(*meshPtr);
+    for (int frame = 0; frame < config.animationFrames; ++frame) {
+        Stopwatch sw;
+        animated.Update(deformer, frame / 60.0f);
+        result.samples["animate"].push_back(sw.ElapsedMs());
+    }
+}
+
+// Repeated level changes, excluded from the total: every level's topology is cached, the first pass
+// up and down the levels warms the arena, and the measured passes after it must not allocate.
+// Levels run from the cage (level 0) up, whatever --min-level says. Each change does what the
+// viewer's worker does in any of its modes: acquire, evaluate (the cage copy at level 0), evaluate
+// to the limit and pack, then hand the buffers to a stand-in render thread and take its old ones back.
+void runSteadyState(const std::shared_ptr<MeshData>& meshPtr, Sdc::SchemeType scheme, const BenchConfig& config, SteadyStateResult& result)
+{
+    constexpr int kPasses = 4;
+    const int numLevels = config.maxLevel + 1;
+    SubdivisionCache cache((size_t)numLevels);
+    std::shared_ptr<const SubdivTopology> top;
+    for (int level = 1; level <= config.maxLevel; ++level) {
+        top = cache.Acquire(meshPtr, scheme, level, true);
+        if (!top) return;
+    }
+    if (!top) return;
+
+    SubdivisionArena arena;
+    arena.Reserve(*top->refiner);
+    top.reset();
+    std::vector<Vertex> frontVerts;
+    std::vector<unsigned int> frontIndices;
+    std::vector<PackedVertex> frontPacked;
+
+    // 0, 1, .., n-1, n-2, .., 1: the next pass starts back at 0
+    const int changesPerPass = std::max(1, 2 * numLevels - 2);
+    auto pass = [&](bool timed) {
+        for (int step = 0; step < changesPerPass; ++step) {
+            const int level = step < numLevels ? step : 2 * numLevels - 2 - step;
+            Stopwatch sw;
+            std::vector<Vertex> verts, limitVerts;
+            std::vector<unsigned int> indices;
+            if (level == 0) {
+                arena.AcquireBase(*meshPtr, verts, indices);
+            }
+            else {
+                std::shared_ptr<const SubdivTopology> topology = cache.Acquire(meshPtr, scheme, level, true);
+                verts = arena.AcquireVertices((size_t)topology->stencils->GetNumStencils());
+                indices = arena.AcquireIndices(topology->indices.size());
+                std::copy(topology->indices.begin(), topology->indices.end(), indices.begin());
+                if (!arena.Evaluate(*topology, *meshPtr, verts, config.threads)) return false;
+                limitVerts = arena.AcquireVertices(verts.size());
+                if (!arena.EvaluateLimit(*topology, *meshPtr, limitVerts, config.threads)) return false;
+            }
+            const std::vector<Vertex>& packSource = limitVerts.empty() ? verts : limitVerts;
+            std::vector<PackedVertex> packed = arena.AcquirePacked(packSource.size());
+            packVertices(packSource.data(), packSource.size(), computePackingBounds(packSource.data(), packSource.size(), config.threads),
+                packed.data(), config.threads);
+            frontVerts.swap(verts);
+            frontIndices.swap(indices);
+            frontPacked.swap(packed);
+            arena.Release(std::move(verts));
+            arena.Release(std::move(limitVerts));
+            arena.Release(std::move(indices));
+            arena.Release(std::move(packed));
+            if (timed) result.samples.push_back(sw.ElapsedMs());
+        }
+        return true;
+    };
+
+    result.samples.reserve(result.samples.size() + (size_t)(kPasses * changesPerPass));
+    AllocationScope warmupScope;
+    if (!pass(false)) return;
+    AllocationCounts warmup = warmupScope.Elapsed();
+
+    AllocationScope steadyScope;
+    for (int p = 0; p < kPasses; ++p) {
+        if (!pass(true)) return;
+    }
+    AllocationCounts steady = steadyScope.Elapsed();
+
+    // Summed over repetitions, so one allocating run is not hidden by the others
+    result.valid = true;
+    result.passes += kPasses;
+    result.levelChanges += (size_t)(kPasses * changesPerPass);
+    result.warmup.allocations += warmup.allocations;
+    result.warmup.bytes += warmup.bytes;
+    result.steady.allocations += steady.allocations;
+    result.steady.bytes += steady.bytes;
+    result.arenaBytes = arena.MemoryBytes() + frontVerts.capacity() * sizeof(Vertex) + frontIndices.capacity() * sizeof(unsigned int)
+        + frontPacked.capacity() * sizeof(PackedVertex);
+}
+
+// Instancing, excluded from the total: copies of the cage moved apart share one topology through the
+// cache (keyed by topology hash), so only the first builds it and the rest run the stencil pass.
+// The baseline builds a topology per copy, as a cache keyed by mesh would.
+void runInstances(const std::shared_ptr<MeshData>& meshPtr, Sdc::SchemeType scheme, const BenchConfig& config, InstanceResult& result)
+{
+    if (config.instances <= 0) return;
+    const int level = config.maxLevel;
+
+    std::vector<std::shared_ptr<MeshData>> instances;
+    for (int i = 0; i < config.instances; ++i) {
+        auto instance = std::make_shared<MeshData>(*meshPtr);
+        for (glm::vec3& p : instance->vertices.Mutable()) p.x += (float)i;
+        instances.push_back(std::move(instance));
+    }
+
+    std::vector<Vertex> verts;
+    Stopwatch sw;
+    SubdivisionCache cache;
+    for (const auto& instance : instances) {
+        auto topology = cache.Acquire(instance, scheme, level);
+        if (!topology) return;
+        cache.Evaluate(*topology, *instance, verts);
+    }
+    result.samples["shared"].push_back(sw.ElapsedMs());
+    result.stats = cache.GetStats();
+
+    sw.Reset();
+    for (const auto& instance : instances) {
+        SubdivisionCache single;
+        auto topology = single.Acquire(instance, scheme, level);
+        if (!topology) return;
+        single.Evaluate(*topology, *instance, verts);
+    }
+    result.samples["per_instance"].push_back(sw.ElapsedMs());
+
+    result.valid = true;
+    result.level = level;
+    result.instances = instances.size();
+}
+
+// Baseline for polygonal cages, excluded from the total: split the cage into triangles and refine with Loop
+void runTriangulatedLoop(const MeshData& triangulated, int level, LevelResult& result)
+{
+    Stopwatch sw;
+    auto refiner = createTopologyRefiner(triangulated, Sdc::SchemeType::SCHEME_LOOP);
+    Far::TopologyRefiner::UniformOptions refineOptions(level);
+    refineOptions.fullTopologyInLastLevel = true;
+    refiner->RefineUniform(refineOptions);
+    result.samples["refine_triangulated"].push_back(sw.ElapsedMs());
+    result.triangulatedFaces = (size_t)refiner->GetLevel(level).GetNumFaces();
+}
+
+void runAdaptive(const MeshData& mesh, Sdc::SchemeType scheme, const BenchConfig& config, AdaptiveResult& result)
+{
+    Stopwatch sw;
+    auto topology = createAdaptiveTopology(mesh, scheme, config.isolationLevel);
+    result.samples["build"].push_back(sw.ElapsedMs());
+    if (!topology) return;
+
+    sw.Reset();
+    std::vector<Vertex> patchPoints;
+    evaluatePatchPoints(*topology, mesh, patchPoints, config.threads);
+    result.samples["points"].push_back(sw.ElapsedMs());
+
+    sw.Reset();
+    AdaptiveOptions options;
+    options.triangleBudget = config.adaptiveBudget;
+    AdaptiveTessellation tessellation;
+    bool ok = tessellateAdaptive(*topology, patchPoints, options, tessellation, config.threads);
+    result.samples["tessellate"].push_back(sw.ElapsedMs());
+
+    result.valid = ok;
+    result.regularPatches = topology->numRegularPatches;
+    result.irregularPatches = topology->numIrregularPatches;
+    result.vertices = tessellation.verts.size();
+    result.triangles = tessellation.indices.size() / 3;
+    result.rateScale = tessellation.rateScale;
+}
+
+void writeSummary(std::ostream& out, const SampleSummary& s)
+{
+    out << "{\"min_ms\": " << s.min << ", \"median_ms\": " << s.median << ", \"p99_ms\": " << s.p99 << "}";
+}
+
+void writeJson(std::ostream& out, const BenchConfig& config, const std::vector<AssetResult>& results)
+{
+    out.precision(6);
+    out << "{\n";
+    out << "  \"schema\": 1,\n";
+    out << "  \"repetitions\": " << config.repetitions << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"evaluation_threads\": " << (config.threads ? config.threads : ThreadPool::Global().GetThreadCount()) << ",\n";
+    out << "  \"mesh_cache\": " << (config.useMeshCache ? "true" : "false") << ",\n";
+    out << "  \"obj_parser\": \"" << (config.assimpObj ? "assimp" : "native") << "\",\n";
+    out << "  \"memory_budget_bytes\": " << config.memoryBudget << ",\n";
+    out << "  \"peak_rss_bytes\": " << peakResidentBytes() << ",\n";
+    out << "  \"meshes\": [\n";
+    for (size_t a = 0; a < results.size(); ++a) {
+        const AssetResult& r = results[a];
+        out << "    {\n";
+        out << "      \"name\": \"" << r.name << "\",\n";
+        out << "      \"base_vertices\": " << r.baseVertices << ",\n";
+        out << "      \"scheme\": \"" << schemeName(r.scheme) << "\",\n";
+        out << "      \"base_faces\": " << r.baseFaces << ",\n";
+        out << "      \"base_triangles\": " << r.baseTriangles << ",\n";
+        out << "      \"load\": ";
+        writeSummary(out, summarizeSamples(r.loadSamples));
+        out << ",\n";
+        out << "      \"peak_rss_bytes\": " << r.peakRssAfter << ",\n";
+        out << "      \"levels\": [\n";
+        for (size_t l = 0; l < r.levels.size(); ++l) {
+            const LevelResult& level = r.levels[l];
+            out << "        {\"level\": " << level.level
+                << ", \"vertices\": " << level.vertices
+                << ", \"faces\": " << level.faces
+                << ", \"triangles\": " << level.triangles
+                << ", \"triangulated_loop_faces\": " << level.triangulatedFaces << ",\n";
+            out << "         \"stages\": {";
+            for (size_t s = 0; s < std::size(kStages); ++s) {
+                auto it = level.samples.find(kStages[s]);
+                out << (s ? ", " : "") << "\"" << kStages[s] << "\": ";
+                writeSummary(out, summarizeSamples(it != level.samples.end() ? it->second : std::vector<double>()));
+            }
+            out << "},\n";
+
+            // End-to-end rate for a cold level change, and for a cached one (stencil pass + normals)
+            SampleSummary total = summarizeSamples(level.samples.at("total"));
+            double parallelMs = summarizeSamples(level.samples.at("interpolate")).median;
+            double serialMs = summarizeSamples(level.samples.at("interpolate_serial")).median;
+            double animateMs = summarizeSamples(level.samples.count("animate") ? level.samples.at("animate") : std::vector<double>()).median;
+            double packMs = summarizeSamples(level.samples.at("pack")).median;
+            double aosMs = summarizeSamples(level.samples.at("interpolate_aos")).median;
+            double refinerMs = summarizeSamples(level.samples.at("interpolate_refiner")).median;
+            double refinerAosMs = summarizeSamples(level.samples.at("interpolate_refiner_aos")).median;
+            out << "         \"packed_bytes_per_vertex\": " << sizeof(PackedVertex)
+                << ", \"pack_vertices_per_second\": " << (packMs > 0 ? level.vertices / (packMs / 1000.0) : 0.0)
+                << ", \"pack_bit_identical\": " << (level.packBitIdentical ? "true" : "false")
+                << ", \"pack_max_position_error\": " << level.packError.maxPosition
+                << ", \"pack_max_position_error_relative\": " << level.packError.maxPositionRelative
+                << ", \"pack_max_normal_error_degrees\": " << level.packError.maxNormalDegrees
+                << ", \"pack_max_uv_error\": " << level.packError.maxUv << ",\n";
+            out << "         \"animated_fps\": " << (animateMs > 0 ? 1000.0 / animateMs : 0.0) << ",\n";
+            out << "         \"interpolate_speedup\": " << (parallelMs > 0 ? serialMs / parallelMs : 0.0)
+                << ", \"parallel_bit_identical\": " << (level.parallelBitIdentical ? "true" : "false") << ",\n";
+            out << "         \"primvar_channels\": \"" << primvarChannelsName(level.channels) << "\""
+                << ", \"channels_speedup\": " << (parallelMs > 0 ? aosMs / parallelMs : 0.0)
+                << ", \"refiner_channels_speedup\": " << (refinerMs > 0 ? refinerAosMs / refinerMs : 0.0)
+                << ", \"channels_bit_identical\": " << (level.channelsBitIdentical ? "true" : "false") << ",\n";
+            out << "         \"meshlets\": " << level.meshlets << ", \"meshlet_bytes\": " << level.meshletBytes
+                << ", \"triangles_per_meshlet\": " << (level.meshlets ? (double)level.triangles / level.meshlets : 0.0) << ",\n";
+            out << "         \"acmr_before\": " << level.cacheBefore.acmr << ", \"acmr_after\": " << level.cacheAfter.acmr
+                << ", \"atvr_before\": " << level.cacheBefore.atvr << ", \"atvr_after\": " << level.cacheAfter.atvr << ",\n";
+            out << "         \"streaming_within_budget\": " << (level.streamingWithinBudget ? "true" : "false")
+                << ", \"streaming_peak_bytes\": " << level.streaming.peakBytes << ", \"streaming_stage_bytes\": {";
+            for (size_t s = 0; s < level.streaming.stages.size(); ++s) {
+                const StreamingStage& stage = level.streaming.stages[s];
+                out << (s ? ", " : "") << "\"" << stage.name << "\": " << stage.TotalBytes();
+            }
+            out << "},\n";
+            double cachedMs = summarizeSamples(level.samples.at("interpolate")).median + summarizeSamples(level.samples.at("normals")).median;
+            auto limitIt = level.samples.find("limit");
+            double limitMs = limitIt != level.samples.end()
+                ? summarizeSamples(level.samples.at("interpolate")).median + summarizeSamples(limitIt->second).median : 0.0;
+            out << "         \"triangles_per_second\": " << (total.median > 0 ? level.triangles / (total.median / 1000.0) : 0.0)
+                << ", \"cached_triangles_per_second\": " << (cachedMs > 0 ? level.triangles / (cachedMs / 1000.0) : 0.0)
+                << ", \"limit_triangles_per_second\": " << (limitMs > 0 ? level.triangles / (limitMs / 1000.0) : 0.0) << "}"
+                << (l + 1 < r.levels.size() ? "," : "") << "\n";
+        }
+        out << "      ]";
+        if (r.adaptive.valid) {
+            const AdaptiveResult& ad = r.adaptive;
+            out << ",\n      \"adaptive\": {\"isolation_level\": " << config.isolationLevel
+                << ", \"triangle_budget\": " << config.adaptiveBudget
+                << ", \"regular_patches\": " << ad.regularPatches
+                << ", \"irregular_patches\": " << ad.irregularPatches
+                << ", \"vertices\": " << ad.vertices
+                << ", \"triangles\": " << ad.triangles
+                << ", \"rate_scale\": " << ad.rateScale << ",\n";
+            out << "        \"stages\": {";
+            const char* const adaptiveStages[] = { "build", "points", "tessellate" };
+            for (size_t s = 0; s < std::size(adaptiveStages); ++s) {
+                out << (s ? ", " : "") << "\"" << adaptiveStages[s] << "\": ";
+                writeSummary(out, summarizeSamples(ad.samples.at(adaptiveStages[s])));
+            }
+            out << "}}";
+        }
+        if (r.instances.valid) {
+            const InstanceResult& in = r.instances;
+            out << ",\n      \"instances\": {\"count\": " << in.instances
+                << ", \"level\": " << in.level
+                << ", \"shared_topologies\": " << in.stats.sharedTopologies
+                << ", \"unique_topologies\": " << in.stats.uniqueTopologies
+                << ", \"shared_hits\": " << in.stats.sharedHits
+                << ", \"topology_bytes\": " << in.stats.topologyBytes
+                << ", \"bytes_saved\": " << in.stats.bytesSaved << ",\n";
+            out << "        \"stages\": {";
+            const char* const instanceStages[] = { "shared", "per_instance" };
+            for (size_t s = 0; s < std::size(instanceStages); ++s) {
+                out << (s ? ", " : "") << "\"" << instanceStages[s] << "\": ";
+                writeSummary(out, summarizeSamples(in.samples.at(instanceStages[s])));
+            }
+            out << "}}";
+        }
+        if (r.steadyState.valid) {
+            const SteadyStateResult& ss = r.steadyState;
+            out << ",\n      \"steady_state\": {\"passes\": " << ss.passes
+                << ", \"level_changes\": " << ss.levelChanges
+                << ", \"warmup_allocations\": " << ss.warmup.allocations
+                << ", \"warmup_allocated_bytes\": " << ss.warmup.bytes
+                << ", \"allocations\": " << ss.steady.allocations
+                << ", \"allocated_bytes\": " << ss.steady.bytes
+                << ", \"arena_bytes\": " << ss.arenaBytes << ",\n";
+            out << "        \"level_change\": ";
+            writeSummary(out, summarizeSamples(ss.samples));
+            out << "}";
+        }
+        out << "\n";
+        out << "    }" << (a + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)) return EXIT_FAILURE;
+    ThreadPool::SetGlobalThreadCount(config.threads);
+    TraceRecorder::Global().SetEnabled(!config.tracePath.empty());
+
+    const std::vector<BenchAsset> assets = {
+        { "bunny", "bunny.obj" },
+        { "suzanne", "suzanne.obj" },
+        { "original_bunny", "original_bunny.obj" },
+        { "cube", "" },
+    };
+
+    // A failed bit-identity check still writes the results, but fails the run
+    bool verified = true;
+    if (!config.assimpObj && !checkObjChunking()) {
+        std::cerr << "[SubdivBench] Error: OBJ parser output depends on the chunking\n";
+        verified = false;
+    }
+    std::vector<AssetResult> results;
+    for (const BenchAsset& asset : assets) {
+        AssetResult result;
+        result.name = asset.name;
+
+        std::shared_ptr<MeshData> mesh;
+        for (int rep = 0; rep < config.repetitions; ++rep) {
+            Stopwatch sw;
+            mesh = loadAsset(asset, config);
+            result.loadSamples.push_back(sw.ElapsedMs());
+        }
+        if (!mesh) {
+            std::cerr << "[SubdivBench] Skipping " << asset.name << ": load failed\n";
+            continue;
+        }
+        result.baseVertices = mesh->vertices.size();
+        result.baseFaces = mesh->vertsPerFace.size();
+        for (int n : mesh->vertsPerFace) result.baseTriangles += n >= 3 ? n - 2 : 0;
+
+        // Loop only takes triangles, so a polygonal cage is split first; any other scheme keeps the
+        // polygons and is compared against that split-then-Loop baseline
+        result.scheme = config.scheme ? *config.scheme : defaultScheme(*mesh);
+        std::shared_ptr<MeshData> triangulated;
+        if (!isTriangleMesh(*mesh)) {
+            triangulated = triangulateMesh(*mesh);
+            if (result.scheme == Sdc::SCHEME_LOOP) {
+                mesh = triangulated;
+                triangulated.reset();
+            }
+        }
+
+        for (int level = config.minLevel; level <= config.maxLevel; ++level) {
+            LevelResult levelResult;
+            levelResult.level = level;
+            for (int rep = 0; rep < config.repetitions; ++rep) {
+                runLevel(mesh, result.scheme, level, config, levelResult);
+                runAnimation(mesh, result.scheme, level, config, levelResult);
+                if (triangulated) runTriangulatedLoop(*triangulated, level, levelResult);
+            }
+            std::cerr << "[SubdivBench] " << asset.name << " level " << level << ": " << levelResult.triangles << " tris, "
+                      << summarizeSamples(levelResult.samples["total"]).median << " ms median, ACMR "
+                      << levelResult.cacheBefore.acmr << " -> " << levelResult.cacheAfter.acmr;
+            if (double animateMs = summarizeSamples(levelResult.samples["animate"]).median; animateMs > 0)
+                std::cerr << ", animated " << 1000.0 / animateMs << " fps";
+            std::cerr << "\n";
+            if (triangulated) {
+                std::cerr << "[SubdivBench] " << asset.name << " level " << level << ": " << schemeName(result.scheme) << " "
+                          << levelResult.faces << " faces, refine " << summarizeSamples(levelResult.samples["refine"]).median
+                          << " ms vs. triangulated loop " << levelResult.triangulatedFaces << " faces, refine "
+                          << summarizeSamples(levelResult.samples["refine_triangulated"]).median << " ms\n";
+            }
+            if (!levelResult.parallelBitIdentical) {
+                std::cerr << "[SubdivBench] Error: " << asset.name << " level " << level << ": parallel stencils differ from serial\n";
+                verified = false;
+            }
+            if (!levelResult.packBitIdentical) {
+                std::cerr << "[SubdivBench] Error: " << asset.name << " level " << level << ": packed vertices differ from the scalar reference\n";
+                verified = false;
+            }
+            if (!levelResult.channelsBitIdentical) {
+                std::cerr << "[SubdivBench] Error: " << asset.name << " level " << level << ": channel passes differ from the full Vertex ones\n";
+                verified = false;
+            }
+            result.levels.push_back(std::move(levelResult));
+        }
+        if (config.isolationLevel > 0) {
+            for (int rep = 0; rep < config.repetitions; ++rep) runAdaptive(*mesh, result.scheme, config, result.adaptive);
+            std::cerr << "[SubdivBench] " << asset.name << " adaptive isolation " << config.isolationLevel << ": "
+                      << result.adaptive.triangles << " tris (budget " << config.adaptiveBudget << ")\n";
+        }
+        for (int rep = 0; rep < config.repetitions; ++rep) runInstances(mesh, result.scheme, config, result.instances);
+        if (result.instances.valid) {
+            const InstanceResult& in = result.instances;
+            std::cerr << "[SubdivBench] " << asset.name << " " << in.instances << " instances at level " << in.level << ": "
+                      << in.stats.sharedTopologies << " shared / " << in.stats.uniqueTopologies << " unique topologies, "
+                      << in.stats.bytesSaved / (1024 * 1024) << " MB saved, " << summarizeSamples(in.samples.at("shared")).median
+                      << " ms vs. " << summarizeSamples(in.samples.at("per_instance")).median << " ms built per instance\n";
+        }
+        for (int rep = 0; rep < config.repetitions; ++rep) runSteadyState(mesh, result.scheme, config, result.steadyState);
+        if (result.steadyState.valid) {
+            std::cerr << "[SubdivBench] " << asset.name << " steady state: " << result.steadyState.steady.allocations << " allocations over "
+                      << result.steadyState.levelChanges << " level changes (warm-up " << result.steadyState.warmup.allocations << ")\n";
+            if (result.steadyState.steady.allocations != 0) {
+                std::cerr << "[SubdivBench] Error: " << asset.name << ": level changes allocate once warm\n";
+                verified = false;
+            }
+        }
+        result.peakRssAfter = peakResidentBytes();
+        results.push_back(std::move(result));
+    }
+
+    if (config.outPath == "-") {
+        writeJson(std::cout, config, results);
+    }
+    else {
+        std::ofstream out(config.outPath);
+        if (!out) {
+            std::cerr << "[SubdivBench] Error: cannot write " << config.outPath << "\n";
+            return EXIT_FAILURE;
+        }
+        writeJson(out, config, results);
+        std::cerr << "[SubdivBench] Wrote " << config.outPath << "\n";
+    }
+
+    // The ring keeps the most recent events only, so long runs trace their last assets
+    if (!config.tracePath.empty()) {
+        TraceRecorder::Global().SetEnabled(false);
+        TraceRecorder::Global().PrintSummary(std::cerr);
+        if (!TraceRecorder::Global().WriteChromeTrace(config.tracePath)) return EXIT_FAILURE;
+        std::cerr << "[SubdivBench] Wrote " << config.tracePath << "\n";
+    }
+    return verified ? EXIT_SUCCESS : EXIT_FAILURE;
+}
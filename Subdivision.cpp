@@ -0,0 +1,249 @@
+#include "Subdivision.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <opensubdiv/far/topologyDescriptor.h>
+#include <opensubdiv/far/topologyRefinerFactory.h>
+#include <opensubdiv/far/stencilTableFactory.h>
+
+#include "MeshPrimitives.h"
+#include "Normals.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+Sdc::Options subdivisionOptions()
+{
+    Sdc::Options options;
+    options.SetVtxBoundaryInterpolation(Sdc::Options::VTX_BOUNDARY_EDGE_ONLY);
+    return options;
+}
+
+std::unique_ptr<Far::TopologyRefiner> createFromDescriptor(const Far::TopologyDescriptor& desc, Sdc::SchemeType scheme)
+{
+    return std::unique_ptr<Far::TopologyRefiner>(Far::TopologyRefinerFactory<Far::TopologyDescriptor>::Create(desc,
+        Far::TopologyRefinerFactory<Far::TopologyDescriptor>::Options(scheme, subdivisionOptions())));
+}
+
+// FNV-1a over 32-bit words rather than bytes (a quarter of the steps), with a final avalanche
+// so that nearby inputs spread over the whole 64 bits
+constexpr uint64_t kFnvOffset = 0xCBF29CE484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001B3ull;
+
+inline uint64_t hashWord(uint64_t h, uint32_t word)
+{
+    return (h ^ word) * kFnvPrime;
+}
+
+inline uint64_t finalizeHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 33);
+}
+
+}
+
+Sdc::SchemeType defaultScheme(const MeshData& mesh)
+{
+    return isTriangleMesh(mesh) ? Sdc::SCHEME_LOOP : Sdc::SCHEME_CATMARK;
+}
+
+const char* schemeName(Sdc::SchemeType scheme)
+{
+    switch (scheme) {
+    case Sdc::SCHEME_LOOP: return "loop";
+    case Sdc::SCHEME_CATMARK: return "catmark";
+    default: return "bilinear";
+    }
+}
+
+bool parseScheme(const char* name, Sdc::SchemeType& scheme)
+{
+    for (Sdc::SchemeType s : { Sdc::SCHEME_LOOP, Sdc::SCHEME_CATMARK, Sdc::SCHEME_BILINEAR }) {
+        if (std::strcmp(name, schemeName(s)) == 0) {
+            scheme = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<Far::TopologyRefiner> createTopologyRefiner(const MeshData& mesh, Sdc::SchemeType scheme)
+{
+    Far::TopologyDescriptor desc;
+    desc.numVertices = (int)mesh.vertices.size();
+    desc.numFaces = (int)mesh.vertsPerFace.size();
+    desc.numVertsPerFace = mesh.vertsPerFace.data();
+    desc.vertIndicesPerFace = (const Far::Index*)mesh.indices.data();
+    return createFromDescriptor(desc, scheme);
+}
+
+uint64_t topologyHash(const MeshData& mesh, Sdc::SchemeType scheme)
+{
+    const Sdc::Options options = subdivisionOptions();
+    uint64_t h = kFnvOffset;
+    for (uint32_t word : { (uint32_t)scheme, (uint32_t)options.GetVtxBoundaryInterpolation(), (uint32_t)options.GetFVarLinearInterpolation(),
+                           (uint32_t)options.GetCreasingMethod(), (uint32_t)options.GetTriangleSubdivision(),
+                           (uint32_t)mesh.vertices.size(), (uint32_t)mesh.vertsPerFace.size(), (uint32_t)mesh.indices.size() })
+        h = hashWord(h, word);
+    for (int n : mesh.vertsPerFace) h = hashWord(h, (uint32_t)n);
+    for (unsigned int index : mesh.indices) h = hashWord(h, index);
+    return finalizeHash(h);
+}
+
+bool sameTopology(const MeshData& mesh, const Far::TopologyLevel& level)
+{
+    if ((size_t)level.GetNumVertices() != mesh.vertices.size() || (size_t)level.GetNumFaces() != mesh.vertsPerFace.size()
+        || (size_t)level.GetNumFaceVertices() != mesh.indices.size())
+        return false;
+
+    const unsigned int* index = mesh.indices.data();
+    for (int f = 0; f < level.GetNumFaces(); ++f) {
+        Far::ConstIndexArray faceVerts = level.GetFaceVertices(f);
+        if (faceVerts.size() != mesh.vertsPerFace[f]) return false;
+        for (int k = 0; k < faceVerts.size(); ++k) {
+            if ((unsigned int)faceVerts[k] != *index++) return false;
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<Far::TopologyRefiner> createTopologyRefiner(const Far::TopologyLevel& level, Sdc::SchemeType scheme)
+{
+    const int numFaces = level.GetNumFaces();
+    std::vector<int> vertsPerFace(numFaces);
+    std::vector<Far::Index> faceVerts;
+    faceVerts.reserve(level.GetNumFaceVertices());
+    for (int f = 0; f < numFaces; ++f) {
+        Far::ConstIndexArray fv = level.GetFaceVertices(f);
+        vertsPerFace[f] = fv.size();
+        faceVerts.insert(faceVerts.end(), fv.begin(), fv.end());
+    }
+
+    // Carry over what is left of the creases; boundary edges are sharpened by the options anyway
+    std::vector<Far::Index> creasePairs, corners;
+    std::vector<float> creaseWeights, cornerWeights;
+    for (int e = 0; e < level.GetNumEdges(); ++e) {
+        float sharpness = level.GetEdgeSharpness(e);
+        if (sharpness <= 0.0f || level.IsEdgeBoundary(e)) continue;
+        Far::ConstIndexArray ev = level.GetEdgeVertices(e);
+        creasePairs.push_back(ev[0]);
+        creasePairs.push_back(ev[1]);
+        creaseWeights.push_back(sharpness);
+    }
+    for (int v = 0; v < level.GetNumVertices(); ++v) {
+        float sharpness = level.GetVertexSharpness(v);
+        if (sharpness <= 0.0f) continue;
+        corners.push_back(v);
+        cornerWeights.push_back(sharpness);
+    }
+
+    Far::TopologyDescriptor desc;
+    desc.numVertices = level.GetNumVertices();
+    desc.numFaces = numFaces;
+    desc.numVertsPerFace = vertsPerFace.data();
+    desc.vertIndicesPerFace = faceVerts.data();
+    desc.numCreases = (int)creaseWeights.size();
+    desc.creaseVertexIndexPairs = creasePairs.data();
+    desc.creaseWeights = creaseWeights.data();
+    desc.numCorners = (int)cornerWeights.size();
+    desc.cornerVertexIndices = corners.data();
+    desc.cornerWeights = cornerWeights.data();
+    return createFromDescriptor(desc, scheme);
+}
+
+std::unique_ptr<const Far::StencilTable> createLastLevelStencils(const Far::TopologyRefiner& refiner)
+{
+    TRACE_SCOPE("stencils");
+    Far::StencilTableFactory::Options options;
+    options.generateOffsets = true;
+    options.generateControlVerts = false;
+    options.generateIntermediateLevels = false;
+    options.factorizeIntermediateLevels = true;
+    return std::unique_ptr<const Far::StencilTable>(Far::StencilTableFactory::Create(refiner, options));
+}
+
+void evaluateStencils(const Far::StencilTable& stencils, const Vertex* controlVerts, Vertex* out, unsigned int numThreads)
+{
+    // Small enough that chunks stay balanced, large enough to amortize the task overhead
+    constexpr size_t kMinStencilsPerChunk = 4096;
+    TRACE_SCOPE("interpolate");
+
+    const size_t numStencils = (size_t)stencils.GetNumStencils();
+    if (numStencils == 0) return;
+
+    ThreadPool& pool = ThreadPool::Global();
+    if (numThreads == 0) numThreads = pool.GetThreadCount();
+    size_t numChunks = std::min<size_t>((size_t)numThreads * 4, (numStencils + kMinStencilsPerChunk - 1) / kMinStencilsPerChunk);
+
+    if (numThreads <= 1 || numChunks <= 1) {
+        stencils.UpdateValues(controlVerts, out);
+        return;
+    }
+
+    pool.ParallelFor(0, numStencils, numChunks, [&](size_t begin, size_t end) {
+        stencils.UpdateValues(controlVerts, out, (Far::Index)begin, (Far::Index)end);
+    }, numThreads);
+}
+
+void extractTriangleIndices(const Far::TopologyLevel& level, unsigned int vertexOffset, std::vector<unsigned int>& indices)
+{
+    TRACE_SCOPE("extract");
+    const int numFaces = level.GetNumFaces();
+    indices.reserve(indices.size() + (size_t)(level.GetNumFaceVertices() - 2 * numFaces) * 3);
+
+    for (int face = 0; face < numFaces; ++face) {
+        Far::ConstIndexArray faceVerts = level.GetFaceVertices(face);
+        for (int k = 1; k + 1 < faceVerts.size(); ++k) {
+            indices.push_back(faceVerts[0] + vertexOffset);
+            indices.push_back(faceVerts[k] + vertexOffset);
+            indices.push_back(faceVerts[k + 1] + vertexOffset);
+        }
+    }
+}
+
+void fillControlVertices(const MeshData& mesh, std::vector<Vertex>& verts)
+{
+    verts.resize(mesh.vertices.size());
+    for (size_t i = 0; i < verts.size(); ++i) {
+        verts[i].pos = mesh.vertices[i];
+        verts[i].normal = glm::vec3(0, 0, 0);
+        verts[i].uv = mesh.uvs[i];
+    }
+}
+
+void recomputeNormals(std::vector<Vertex>& verts, const std::vector<unsigned int>& indices)
+{
+    VertexFaceAdjacency adjacency;
+    buildVertexFaceAdjacency(indices.data(), indices.size() / 3, verts.size(), adjacency);
+    recomputeNormals(verts, indices, adjacency);
+}
+
+void recomputeNormals(std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, const VertexFaceAdjacency& adjacency, unsigned int numThreads)
+{
+    FaceNormalsSoA faceNormals;
+    recomputeNormals(verts, indices, adjacency, faceNormals, numThreads);
+}
+
+void recomputeNormals(std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, const VertexFaceAdjacency& adjacency,
+    FaceNormalsSoA& faceNormals, unsigned int numThreads)
+{
+    static_assert(sizeof(Vertex) % sizeof(float) == 0, "Vertex must be a plain float record");
+    constexpr size_t kStride = sizeof(Vertex) / sizeof(float);
+    if (verts.empty()) return;
+    TRACE_SCOPE("normals");
+
+    float* base = glm::value_ptr(verts.data()->pos);
+    computeFaceNormals(base, kStride, verts.size(), indices.data(), indices.size() / 3, faceNormals, numThreads);
+    gatherVertexNormals(adjacency, faceNormals, base + offsetof(Vertex, normal) / sizeof(float), kStride, numThreads);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include <opensubdiv/far/topologyRefiner.h>
+#include <opensubdiv/far/stencilTable.h>
+
+#include "Normals.h"
+#include "ResourceManager.h"
+
+typedef struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 uv;
+    void Clear(void* = 0) { pos = glm::vec3(0); normal = glm::vec3(0); uv = glm::vec2(0); }
+    void AddWithWeight(const Vertex& src, float weight) { pos += src.pos * weight; normal += src.normal * weight; uv += src.uv * weight; }
+} Vertex;
+
+// Loop for an all-triangle cage, Catmull-Clark otherwise (Loop only refines triangles)
+OpenSubdiv::Sdc::SchemeType defaultScheme(const MeshData& mesh);
+
+// "loop", "catmark" or "bilinear"; parseScheme accepts the same names
+const char* schemeName(OpenSubdiv::Sdc::SchemeType scheme);
+bool parseScheme(const char* name, OpenSubdiv::Sdc::SchemeType& scheme);
+
+// Builds a refiner for the base cage of mesh (not refined yet)
+std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> createTopologyRefiner(const MeshData& mesh, OpenSubdiv::Sdc::SchemeType scheme);
+
+// Hash of everything createTopologyRefiner(mesh, scheme) depends on: vertex count, vertsPerFace,
+// indices, scheme and options. Positions, normals and uvs are left out, so instances and variants
+// of one cage hash the same.
+uint64_t topologyHash(const MeshData& mesh, OpenSubdiv::Sdc::SchemeType scheme);
+
+// True when level has exactly the vertex count and faces of mesh, e.g. to rule out a hash collision
+bool sameTopology(const MeshData& mesh, const OpenSubdiv::Far::TopologyLevel& level);
+
+// Builds an unrefined refiner whose base is a refined level (faces plus remaining crease and corner
+// sharpness), so refinement can continue from that level without starting over from the cage
+std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> createTopologyRefiner(const OpenSubdiv::Far::TopologyLevel& level, OpenSubdiv::Sdc::SchemeType scheme);
+
+// Stencils from the base cage straight to the last refined level (intermediate levels factorized away)
+std::unique_ptr<const OpenSubdiv::Far::StencilTable> createLastLevelStencils(const OpenSubdiv::Far::TopologyRefiner& refiner);
+
+// Runs stencils over the control vertices into out (one element per stencil). The stencil range is
+// split across the global thread pool; every stencil is summed in the same order as the serial
+// UpdateValues, so the result is bit-identical for any thread count. numThreads == 0 uses all workers.
+void evaluateStencils(const OpenSubdiv::Far::StencilTable& stencils, const Vertex* controlVerts, Vertex* out, unsigned int numThreads = 0);
+
+// Appends the faces of a refined level as triangles, offsetting each index by vertexOffset. Quads
+// and n-gons (Catmull-Clark, Bilinear) are fan-split here, so topology stays polygonal until drawing.
+void extractTriangleIndices(const OpenSubdiv::Far::TopologyLevel& level, unsigned int vertexOffset, std::vector<unsigned int>& indices);
+
+// Copies the base cage into the primvar layout used for refinement
+void fillControlVertices(const MeshData& mesh, std::vector<Vertex>& verts);
+
+// Area-weighted smooth normals over a triangle list; builds the vertex-face adjacency on the fly
+void recomputeNormals(std::vector<Vertex>& verts, const std::vector<unsigned int>& indices);
+
+// Same, reusing an adjacency built once for this triangle list (e.g. the one cached with the topology)
+void recomputeNormals(std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+    const VertexFaceAdjacency& adjacency, unsigned int numThreads = 0);
+
+// Same, with the face normals kept in caller-owned scratch that only grows between calls
+void recomputeNormals(std::vector<Vertex>& verts, const std::vector<unsigned int>& indices,
+    const VertexFaceAdjacency& adjacency, FaceNormalsSoA& faceNormals, unsigned int numThreads = 0);
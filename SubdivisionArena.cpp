@@ -0,0 +1,215 @@
+#include "SubdivisionArena.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "LimitSurface.h"
+#include "MeshPrimitives.h"
+#include "SubdivisionCache.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+template <typename T>
+size_t capacityBytes(const std::vector<T>& v)
+{
+    return v.capacity() * sizeof(T);
+}
+
+// reserve() that reports whether it had to allocate
+template <typename T>
+bool reserveFor(std::vector<T>& v, size_t count)
+{
+    if (v.capacity() >= count) return false;
+    v.reserve(count);
+    return true;
+}
+
+}
+
+SubdivisionArena::SubdivisionArena(size_t maxFreeBuffers)
+    : maxFreeBuffers(maxFreeBuffers)
+{
+    freeVerts.reserve(maxFreeBuffers);
+    freeIndices.reserve(maxFreeBuffers);
+    freePacked.reserve(maxFreeBuffers);
+}
+
+void SubdivisionArena::Reserve(const Far::TopologyRefiner& refiner)
+{
+    size_t triangles = 0;
+    for (int l = 1; l < refiner.GetNumLevels(); ++l) {
+        const Far::TopologyLevel& level = refiner.GetLevel(l);
+        triangles = std::max(triangles, (size_t)(level.GetNumFaceVertices() - 2 * level.GetNumFaces()));
+    }
+    Grow((size_t)refiner.GetLevel(0).GetNumVertices(), triangles);
+}
+
+void SubdivisionArena::Grow(size_t baseVertices, size_t triangles)
+{
+    // Evaluate never asks for interpolated normals, so their rows stay empty
+    bool grew = reserveFor(controlVerts, baseVertices);
+    grew |= reserveFor(controlChannels.positions, baseVertices * 4);
+    grew |= reserveFor(controlChannels.uvs, baseVertices * 2);
+    grew |= reserveFor(faceNormals.x, triangles);
+    grew |= reserveFor(faceNormals.y, triangles);
+    grew |= reserveFor(faceNormals.z, triangles);
+    if (grew) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.grown++;
+    }
+}
+
+bool SubdivisionArena::Evaluate(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& verts, unsigned int numThreads)
+{
+    if (!topology.stencils || topology.level <= 0) return false;
+    if (verts.size() != (size_t)topology.stencils->GetNumStencils()) {
+        std::cerr << "[SubdivisionArena] Error: output holds " << verts.size() << " vertices, level " << topology.level
+                  << " has " << topology.stencils->GetNumStencils() << "\n";
+        return false;
+    }
+
+    Grow(mesh.vertices.size(), topology.indices.size() / 3);
+    Interpolate(topology, mesh, verts.data(), numThreads);
+    recomputeNormals(verts, topology.indices, topology.adjacency, faceNormals, numThreads);
+    return true;
+}
+
+bool SubdivisionArena::EvaluateLimit(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& verts, unsigned int numThreads)
+{
+    if (!topology.limit) return Evaluate(topology, mesh, verts, numThreads);
+    if (!topology.stencils || topology.level <= 0) return false;
+    if (verts.size() != topology.limit->NumVertices() || verts.size() != (size_t)topology.stencils->GetNumStencils()) {
+        std::cerr << "[SubdivisionArena] Error: output holds " << verts.size() << " vertices, level " << topology.level
+                  << " has " << topology.stencils->GetNumStencils() << "\n";
+        return false;
+    }
+
+    // The limit pass writes the normals, so the refined vertices skip recomputeNormals
+    Grow(mesh.vertices.size(), 0);
+    if (reserveFor(refinedVerts, verts.size())) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.grown++;
+    }
+    refinedVerts.resize(verts.size());
+    Interpolate(topology, mesh, refinedVerts.data(), numThreads);
+    evaluateLimit(*topology.limit, refinedVerts.data(), verts.data(), numThreads);
+    return true;
+}
+
+void SubdivisionArena::AcquireBase(const MeshData& mesh, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+    size_t triangles = 0;
+    for (int n : mesh.vertsPerFace) triangles += n >= 3 ? (size_t)(n - 2) : 0;
+
+    verts = AcquireVertices(mesh.vertices.size());
+    for (size_t i = 0; i < verts.size(); ++i) {
+        verts[i].pos = mesh.vertices[i];
+        verts[i].normal = mesh.normals[i];
+        verts[i].uv = mesh.uvs[i];
+    }
+    // triangulateFaces appends, and clear keeps the capacity just acquired
+    indices = AcquireIndices(triangles * 3);
+    indices.clear();
+    triangulateFaces(mesh.vertsPerFace.data(), mesh.vertsPerFace.size(), mesh.indices.data(), 0, indices);
+}
+
+void SubdivisionArena::Interpolate(const SubdivTopology& topology, const MeshData& mesh, Vertex* out, unsigned int numThreads)
+{
+    fillControlVertices(mesh, controlVerts);
+    controlChannels.Load(controlVerts.data(), controlVerts.size(), primvarChannelsFor(mesh));
+    evaluateStencilChannels(*topology.stencils, controlChannels, out, numThreads);
+}
+
+template <typename T>
+std::vector<T> SubdivisionArena::Acquire(std::vector<std::vector<T>>& pool, size_t count)
+{
+    std::vector<T> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Smallest buffer that fits, so a small level does not take the one a large level needs
+        size_t pick = pool.size();
+        for (size_t i = 0; i < pool.size(); ++i) {
+            if (pool[i].capacity() < count) continue;
+            if (pick == pool.size() || pool[i].capacity() < pool[pick].capacity()) pick = i;
+        }
+        if (pick == pool.size()) {
+            for (size_t i = 0; i < pool.size(); ++i) {
+                if (pick == pool.size() || pool[i].capacity() > pool[pick].capacity()) pick = i;
+            }
+        }
+        if (pick < pool.size()) {
+            buffer = std::move(pool[pick]);
+            pool[pick] = std::move(pool.back());
+            pool.pop_back();
+        }
+        if (buffer.capacity() >= count) stats.reused++;
+        else stats.grown++;
+    }
+    buffer.resize(count);
+    return buffer;
+}
+
+template <typename T>
+void SubdivisionArena::Release(std::vector<std::vector<T>>& pool, std::vector<T>&& buffer)
+{
+    std::vector<T> dropped = std::move(buffer);
+    if (dropped.capacity() == 0) return;
+    dropped.clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pool.size() < maxFreeBuffers) {
+        pool.push_back(std::move(dropped));
+        return;
+    }
+    stats.dropped++;
+}
+
+std::vector<Vertex> SubdivisionArena::AcquireVertices(size_t count)
+{
+    return Acquire(freeVerts, count);
+}
+
+std::vector<unsigned int> SubdivisionArena::AcquireIndices(size_t count)
+{
+    return Acquire(freeIndices, count);
+}
+
+std::vector<PackedVertex> SubdivisionArena::AcquirePacked(size_t count)
+{
+    return Acquire(freePacked, count);
+}
+
+void SubdivisionArena::Release(std::vector<Vertex>&& verts)
+{
+    Release(freeVerts, std::move(verts));
+}
+
+void SubdivisionArena::Release(std::vector<unsigned int>&& indices)
+{
+    Release(freeIndices, std::move(indices));
+}
+
+void SubdivisionArena::Release(std::vector<PackedVertex>&& packed)
+{
+    Release(freePacked, std::move(packed));
+}
+
+size_t SubdivisionArena::MemoryBytes() const
+{
+    size_t bytes = capacityBytes(controlVerts) + capacityBytes(controlChannels.positions) + capacityBytes(controlChannels.normals)
+        + capacityBytes(controlChannels.uvs) + capacityBytes(faceNormals.x) + capacityBytes(faceNormals.y) + capacityBytes(faceNormals.z)
+        + capacityBytes(refinedVerts);
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& v : freeVerts) bytes += capacityBytes(v);
+    for (const auto& v : freeIndices) bytes += capacityBytes(v);
+    for (const auto& v : freePacked) bytes += capacityBytes(v);
+    return bytes;
+}
+
+SubdivisionArena::Stats SubdivisionArena::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <opensubdiv/far/topologyRefiner.h>
+
+#include "Normals.h"
+#include "PrimvarChannels.h"
+#include "Subdivision.h"
+#include "VertexPacking.h"
+
+struct SubdivTopology;
+
+// Reusable storage for re-evaluating cached topologies. Scratch (cage copy, channel rows, face
+// normals, refined vertices for the limit pass) only ever grows, and output buffers circulate
+// through free lists instead of being freed: the worker acquires them, the render thread hands
+// back the ones it swapped out. Once the buffers have reached the largest level in use, changing
+// between levels (including the cage, limit and packed output) does not touch the heap.
+class SubdivisionArena {
+public:
+    struct Stats {
+        size_t reused = 0;  // acquires served by a free buffer large enough
+        size_t grown = 0;   // acquires or scratch resizes that had to allocate
+        size_t dropped = 0; // releases past the free-list limit
+    };
+
+    explicit SubdivisionArena(size_t maxFreeBuffers = 4);
+    SubdivisionArena(const SubdivisionArena&) = delete;
+    SubdivisionArena& operator=(const SubdivisionArena&) = delete;
+
+    // Sizes scratch for the largest level of refiner (vertices and fan-split triangles per level),
+    // so evaluating any level of this cage afterwards stays within capacity
+    void Reserve(const OpenSubdiv::Far::TopologyRefiner& refiner);
+
+    // Stencil pass from the cage of mesh plus smooth normals into verts, which must already hold
+    // one element per stencil (AcquireVertices). Uses the shared scratch: call from one thread.
+    bool Evaluate(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& verts, unsigned int numThreads = 0);
+
+    // Like SubdivisionCache::EvaluateLimit: the stencil pass into scratch, then the limit masks into
+    // verts. Falls back to Evaluate when the topology was acquired without limit masks.
+    bool EvaluateLimit(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& verts, unsigned int numThreads = 0);
+
+    // Level 0: the cage with its own normals, and its faces fan-split, in buffers from the free lists
+    void AcquireBase(const MeshData& mesh, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+    // Buffers of count elements taken from the free lists: the smallest that fits, else the
+    // largest, which then grows. Thread-safe, like Release.
+    std::vector<Vertex> AcquireVertices(size_t count);
+    std::vector<unsigned int> AcquireIndices(size_t count);
+    std::vector<PackedVertex> AcquirePacked(size_t count);
+    void Release(std::vector<Vertex>&& verts);
+    void Release(std::vector<unsigned int>&& indices);
+    void Release(std::vector<PackedVertex>&& packed);
+
+    size_t MemoryBytes() const;
+    Stats GetStats() const;
+
+private:
+    template <typename T>
+    std::vector<T> Acquire(std::vector<std::vector<T>>& pool, size_t count);
+    template <typename T>
+    void Release(std::vector<std::vector<T>>& pool, std::vector<T>&& buffer);
+    void Grow(size_t baseVertices, size_t triangles);
+    void Interpolate(const SubdivTopology& topology, const MeshData& mesh, Vertex* out, unsigned int numThreads);
+
+    size_t maxFreeBuffers;
+
+    // Evaluate scratch
+    std::vector<Vertex> controlVerts;
+    PrimvarBuffer controlChannels;
+    FaceNormalsSoA faceNormals;
+    std::vector<Vertex> refinedVerts; // EvaluateLimit input
+
+    mutable std::mutex mutex; // free lists and stats
+    std::vector<std::vector<Vertex>> freeVerts;
+    std::vector<std::vector<unsigned int>> freeIndices;
+    std::vector<std::vector<PackedVertex>> freePacked;
+    Stats stats;
+};
@@ -0,0 +1,204 @@
+#include "SubdivisionCache.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "PrimvarChannels.h"
+#include "StreamingSubdivision.h"
+#include "Trace.h"
+
+using namespace OpenSubdiv;
+
+namespace {
+
+void ensureLimitMasks(SubdivTopology& topology)
+{
+    if (topology.limit || topology.level <= 0) return;
+    auto masks = std::make_unique<LimitMasks>();
+    if (buildLimitMasks(*topology.refiner, *masks)) topology.limit = std::move(masks);
+}
+
+}
+
+size_t SubdivTopology::MemoryBytes() const
+{
+    size_t bytes = sizeof(SubdivTopology) + indices.capacity() * sizeof(unsigned int)
+        + (adjacency.offsets.capacity() + adjacency.faces.capacity()) * sizeof(unsigned int);
+    if (refiner) {
+        for (int l = 0; l < refiner->GetNumLevels(); ++l) bytes += estimateTopologyLevelBytes(refiner->GetLevel(l));
+    }
+    if (stencils) {
+        bytes += (stencils->GetSizes().size() + stencils->GetOffsets().size() + stencils->GetControlIndices().size()) * sizeof(int)
+            + stencils->GetWeights().size() * sizeof(float);
+    }
+    if (limit) bytes += limit->MemoryBytes();
+    return bytes;
+}
+
+std::shared_ptr<const SubdivTopology> SubdivisionCache::Acquire(const std::shared_ptr<MeshData>& mesh, Sdc::SchemeType scheme, int level, bool withLimit)
+{
+    if (!mesh) return nullptr;
+
+    Key key{ HashOf(mesh, scheme), scheme, level };
+    if (auto it = entries.find(key); it != entries.end()) {
+        Entry& entry = *it->second;
+        bool known = std::any_of(entry.meshes.begin(), entry.meshes.end(),
+            [&mesh](const std::weak_ptr<MeshData>& m) { return m.lock() == mesh; });
+        if (!known) {
+            // First time this mesh uses the entry: make sure the hash did not merge two cages
+            if (!sameTopology(*mesh, entry.topology->refiner->GetLevel(0))) {
+                std::cerr << "[SubdivisionCache] Warning: topology hash collision, building level " << level << " without caching\n";
+                stats.collisions++;
+                stats.misses++;
+                std::shared_ptr<SubdivTopology> topology = Build(*mesh, scheme, level);
+                if (topology && withLimit) ensureLimitMasks(*topology);
+                return topology;
+            }
+            entry.meshes.erase(std::remove_if(entry.meshes.begin(), entry.meshes.end(),
+                [](const std::weak_ptr<MeshData>& m) { return m.expired(); }), entry.meshes.end());
+            entry.meshes.push_back(mesh);
+            stats.sharedHits++;
+        }
+
+        lru.splice(lru.begin(), lru, it->second);
+        stats.hits++;
+        if (withLimit && !entry.topology->limit) {
+            ensureLimitMasks(*entry.topology);
+            entry.bytes = entry.topology->MemoryBytes();
+        }
+        return entry.topology;
+    }
+
+    stats.misses++;
+    std::shared_ptr<SubdivTopology> topology = Build(*mesh, scheme, level);
+    if (!topology) return nullptr;
+    if (withLimit) ensureLimitMasks(*topology);
+
+    lru.push_front(Entry{ key, topology, topology->MemoryBytes(), { mesh } });
+    entries[key] = lru.begin();
+    EvictToCapacity();
+    return topology;
+}
+
+uint64_t SubdivisionCache::HashOf(const std::shared_ptr<MeshData>& mesh, Sdc::SchemeType scheme)
+{
+    auto it = meshHashes.find(mesh.get());
+    if (it != meshHashes.end() && it->second.scheme == scheme && it->second.mesh.lock() == mesh) return it->second.hash;
+
+    // Drop meshes that are gone before adding one, so the map tracks the live set
+    if (meshHashes.size() >= 4 * maxEntries + 16) {
+        for (auto m = meshHashes.begin(); m != meshHashes.end();)
+            m = m->second.mesh.expired() ? meshHashes.erase(m) : std::next(m);
+    }
+
+    TRACE_SCOPE("topology_hash");
+    uint64_t hash = topologyHash(*mesh, scheme);
+    meshHashes[mesh.get()] = MeshHash{ mesh, scheme, hash };
+    return hash;
+}
+
+std::shared_ptr<SubdivTopology> SubdivisionCache::Build(const MeshData& mesh, Sdc::SchemeType scheme, int level)
+{
+    auto topology = std::make_shared<SubdivTopology>();
+    topology->scheme = scheme;
+    topology->level = level;
+
+    topology->refiner = createTopologyRefiner(mesh, scheme);
+    if (!topology->refiner) {
+        std::cerr << "[SubdivisionCache] Error: failed to create topology refiner\n";
+        return nullptr;
+    }
+    // Full topology in the last level gives us its vertex-face relation for the normal gather
+    {
+        TRACE_SCOPE("refine");
+        Far::TopologyRefiner::UniformOptions refineOptions(level);
+        refineOptions.fullTopologyInLastLevel = true;
+        topology->refiner->RefineUniform(refineOptions);
+    }
+
+    // Only the last level is needed, so intermediate levels are folded into the stencil weights
+    topology->stencils = createLastLevelStencils(*topology->refiner);
+
+    const Far::TopologyLevel& lastLevel = topology->refiner->GetLevel(level);
+    extractTriangleIndices(lastLevel, 0, topology->indices);
+    if (!buildVertexFaceAdjacency(lastLevel, topology->adjacency)) {
+        buildVertexFaceAdjacency(topology->indices.data(), topology->indices.size() / 3,
+            (size_t)lastLevel.GetNumVertices(), topology->adjacency);
+    }
+    return topology;
+}
+
+void SubdivisionCache::Evaluate(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& outVerts) const
+{
+    std::vector<Vertex> controlVerts;
+    fillControlVertices(mesh, controlVerts);
+
+    if (!topology.stencils || topology.level <= 0) {
+        outVerts = std::move(controlVerts);
+        return;
+    }
+
+    outVerts.resize(topology.stencils->GetNumStencils());
+    if (outVerts.empty()) return;
+
+    // Normals are recomputed after this (or come from the limit pass), so only positions and any uvs are blended
+    PrimvarBuffer control;
+    control.Load(controlVerts.data(), controlVerts.size(), primvarChannelsFor(mesh));
+    evaluateStencilChannels(*topology.stencils, control, outVerts.data(), evaluationThreads);
+}
+
+void SubdivisionCache::EvaluateLimit(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& outVerts) const
+{
+    if (!topology.limit) {
+        Evaluate(topology, mesh, outVerts);
+        recomputeNormals(outVerts, topology.indices, topology.adjacency, evaluationThreads);
+        return;
+    }
+
+    std::vector<Vertex> refined;
+    Evaluate(topology, mesh, refined);
+    outVerts.resize(refined.size());
+    evaluateLimit(*topology.limit, refined.data(), outVerts.data(), evaluationThreads);
+}
+
+void SubdivisionCache::SetMaxEntries(size_t count)
+{
+    maxEntries = count;
+    EvictToCapacity();
+}
+
+void SubdivisionCache::Clear()
+{
+    lru.clear();
+    entries.clear();
+    meshHashes.clear();
+}
+
+SubdivisionCache::Stats SubdivisionCache::GetStats() const
+{
+    Stats s = stats;
+    s.entries = entries.size();
+    for (const Entry& entry : lru) {
+        size_t live = (size_t)std::count_if(entry.meshes.begin(), entry.meshes.end(),
+            [](const std::weak_ptr<MeshData>& m) { return !m.expired(); });
+        s.instances += live;
+        s.topologyBytes += entry.bytes;
+        if (live >= 2) {
+            s.sharedTopologies++;
+            s.bytesSaved += (live - 1) * entry.bytes;
+        }
+        else {
+            s.uniqueTopologies++;
+        }
+    }
+    return s;
+}
+
+void SubdivisionCache::EvictToCapacity()
+{
+    while (lru.size() > maxEntries && !lru.empty()) {
+        entries.erase(lru.back().key);
+        lru.pop_back();
+        stats.evictions++;
+    }
+}
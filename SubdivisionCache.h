@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <opensubdiv/far/topologyRefiner.h>
+#include <opensubdiv/far/stencilTable.h>
+
+#include "LimitSurface.h"
+#include "Subdivision.h"
+
+// Everything needed to re-evaluate one mesh at one level without touching topology, shared by every
+// mesh with the same cage connectivity. The refiner, stencils, indices and adjacency are immutable
+// once built; limit is filled in later by Acquire(withLimit) on the worker thread, so only the worker
+// reads it (the render thread's AnimatedSubdivision uses the stencils, indices and adjacency alone).
+struct SubdivTopology {
+    OpenSubdiv::Sdc::SchemeType scheme = OpenSubdiv::Sdc::SCHEME_LOOP;
+    int level = 0;
+    std::unique_ptr<OpenSubdiv::Far::TopologyRefiner> refiner;
+    std::unique_ptr<const OpenSubdiv::Far::StencilTable> stencils; // base cage -> last level, factorized
+    std::vector<unsigned int> indices;                            // last level triangles, indexing stencil outputs
+    VertexFaceAdjacency adjacency;                                // last level vertex -> triangles, for normals
+    std::unique_ptr<const LimitMasks> limit;                      // last level -> limit surface, built on request (worker only)
+
+    // Refiner levels (estimated like the streaming path), stencils, triangles, adjacency and limit masks
+    size_t MemoryBytes() const;
+};
+
+class SubdivisionCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t sharedHits = 0; // hits by a mesh other than the ones already using the entry
+        size_t collisions = 0; // equal hash, different connectivity; built without caching
+        size_t evictions = 0;
+        size_t entries = 0;
+        // Over the entries, counting only meshes that are still alive
+        size_t instances = 0;        // meshes served by some entry
+        size_t sharedTopologies = 0; // entries used by two or more meshes
+        size_t uniqueTopologies = 0; // entries used by one mesh (or none left)
+        size_t topologyBytes = 0;    // held by the cache
+        size_t bytesSaved = 0;       // what per-mesh copies of the shared entries would add
+    };
+
+    explicit SubdivisionCache(size_t maxEntries = 16) : maxEntries(maxEntries) {}
+    SubdivisionCache(const SubdivisionCache&) = delete;
+    SubdivisionCache& operator=(const SubdivisionCache&) = delete;
+
+    // Returns the cached topology for (mesh, scheme, level), building it on a miss. Entries are keyed
+    // by topologyHash, not by mesh, so meshes that only differ in positions (instances, variants, a
+    // re-created cage) share one entry and only the stencil pass runs per mesh. An entry outlives the
+    // meshes it served until it is evicted. withLimit also builds the limit masks (once per entry) so
+    // EvaluateLimit can use them; this sets SubdivTopology::limit on an entry other holders may already
+    // share, so call Acquire from the worker thread only.
+    [[nodiscard]] std::shared_ptr<const SubdivTopology> Acquire(const std::shared_ptr<MeshData>& mesh,
+        OpenSubdiv::Sdc::SchemeType scheme, int level, bool withLimit = false);
+
+    // Single stencil pass from the base cage to the last level
+    void Evaluate(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& outVerts) const;
+
+    // Stencil pass followed by the limit pass: limit positions, and normals from the limit tangents.
+    // Falls back to Evaluate + recomputeNormals when the topology has no limit masks.
+    void EvaluateLimit(const SubdivTopology& topology, const MeshData& mesh, std::vector<Vertex>& outVerts) const;
+
+    // Threads that run Evaluate's stencil chunks at once, the caller included; 0 uses every worker of the global pool
+    void SetEvaluationThreads(unsigned int count) { evaluationThreads = count; }
+    unsigned int GetEvaluationThreads() const { return evaluationThreads; }
+
+    void SetMaxEntries(size_t count);
+    size_t GetMaxEntries() const { return maxEntries; }
+    void Clear();
+
+    Stats GetStats() const;
+
+private:
+    struct Key {
+        uint64_t topology; // topologyHash, which already covers the scheme
+        OpenSubdiv::Sdc::SchemeType scheme;
+        int level;
+        bool operator==(const Key& o) const { return topology == o.topology && scheme == o.scheme && level == o.level; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            size_t h = (size_t)k.topology;
+            h ^= ((size_t)k.scheme << 8 | (size_t)k.level) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+    struct Entry {
+        Key key;
+        std::shared_ptr<SubdivTopology> topology;
+        size_t bytes = 0;
+        std::vector<std::weak_ptr<MeshData>> meshes; // checked against the refiner's base level when added
+    };
+    // Hash per mesh, so a mesh is hashed once rather than on every level change
+    struct MeshHash {
+        std::weak_ptr<MeshData> mesh; // guards against a new mesh reusing a freed address
+        OpenSubdiv::Sdc::SchemeType scheme;
+        uint64_t hash;
+    };
+
+    static std::shared_ptr<SubdivTopology> Build(const MeshData& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level);
+    uint64_t HashOf(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme);
+    void EvictToCapacity();
+
+    size_t maxEntries;
+    unsigned int evaluationThreads = 0;
+    std::list<Entry> lru; // most recently used at the front
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+    std::unordered_map<const MeshData*, MeshHash> meshHashes;
+    Stats stats;
+};
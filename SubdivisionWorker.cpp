@@ -0,0 +1,117 @@
+#include "SubdivisionWorker.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+SubdivisionWorker::SubdivisionWorker()
+{
+    thread = std::thread([this]() { Run(); });
+}
+
+SubdivisionWorker::~SubdivisionWorker()
+{
+    Stop();
+}
+
+void SubdivisionWorker::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.reset();
+        if (runningCancel) runningCancel->store(true);
+    }
+    cv.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+uint64_t SubdivisionWorker::Submit(Job job)
+{
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return 0;
+        id = nextId++;
+        stats.submitted++;
+        if (pending) stats.cancelled++;
+        if (runningCancel) runningCancel->store(true);
+        pending = Pending{ id, std::move(job), Stopwatch() };
+    }
+    cv.notify_one();
+    return id;
+}
+
+bool SubdivisionWorker::TakeResult(SubdivisionResult& out)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ready) return false;
+    out = std::move(*ready);
+    ready.reset();
+    return true;
+}
+
+size_t SubdivisionWorker::GetQueueDepth() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (pending ? 1 : 0) + (runningCancel ? 1 : 0);
+}
+
+SubdivisionWorker::Stats SubdivisionWorker::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats s = stats;
+    s.queueDepth = (pending ? 1 : 0) + (runningCancel ? 1 : 0);
+    return s;
+}
+
+void SubdivisionWorker::Run()
+{
+    for (;;) {
+        Pending job;
+        std::shared_ptr<CancelFlag> cancel = std::make_shared<CancelFlag>(false);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || pending.has_value(); });
+            if (stopping) return;
+            job = std::move(*pending);
+            pending.reset();
+            runningCancel = cancel;
+        }
+
+        SubdivisionResult result;
+        result.requestId = job.id;
+        bool ok = false;
+        try {
+            ok = job.job(*cancel, result);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[SubdivisionWorker] Error: job " << job.id << " threw: " << e.what() << "\n";
+        }
+        result.latencyMs = job.submitted.ElapsedMs();
+
+        SubdivisionResult dropped;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            runningCancel.reset();
+            if (cancel->load()) {
+                // Superseded: even a finished result is stale now
+                stats.cancelled++;
+                dropped = std::move(result);
+            }
+            else if (!ok) {
+                stats.failed++;
+                dropped = std::move(result);
+            }
+            else {
+                stats.completed++;
+                stats.lastLatencyMs = result.latencyMs;
+                stats.averageLatencyMs += (result.latencyMs - stats.averageLatencyMs) / (double)stats.completed;
+                stats.maxLatencyMs = std::max(stats.maxLatencyMs, result.latencyMs);
+                if (ready) dropped = std::move(*ready);
+                ready = std::move(result);
+            }
+        }
+        if (recycle) recycle(std::move(dropped));
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+#include "Subdivision.h"
+#include "VertexPacking.h"
+
+struct SubdivTopology;
+
+// Output of one background job. The worker fills its own copy (back buffer) and the render
+// thread swaps it in with TakeResult (front buffer), so drawing never waits on subdivision.
+struct SubdivisionResult {
+    uint64_t requestId = 0;
+    std::shared_ptr<MeshData> mesh;
+    int level = 0;
+    std::vector<Vertex> verts;
+    std::vector<unsigned int> indices;
+    // Animation jobs leave verts/indices empty and hand over the topology (null at level 0); the
+    // render thread deforms mesh and evaluates it every frame
+    bool animated = false;
+    std::shared_ptr<const SubdivTopology> topology;
+    // Set instead of verts when the job packs its output for upload
+    std::vector<PackedVertex> packedVerts;
+    VertexPackingBounds packingBounds;
+    double latencyMs = 0.0; // Submit -> result ready
+};
+
+// Runs subdivision jobs one at a time on a dedicated thread. Only the newest request matters:
+// submitting drops a job that has not started and asks the running one to stop.
+class SubdivisionWorker {
+public:
+    using CancelFlag = std::atomic<bool>;
+    // Jobs poll cancelled between stages and return false when they gave up (or failed)
+    using Job = std::function<bool(const CancelFlag& cancelled, SubdivisionResult& result)>;
+    // Receives results nobody will take (cancelled, failed, or replaced by a newer one before the
+    // render thread took it), so their buffers can go back to a pool instead of being freed
+    using Recycler = std::function<void(SubdivisionResult&& dropped)>;
+
+    struct Stats {
+        size_t submitted = 0;
+        size_t completed = 0;
+        size_t cancelled = 0; // dropped before starting, stopped early, or finished after being superseded
+        size_t failed = 0;
+        size_t queueDepth = 0; // waiting + running
+        double lastLatencyMs = 0.0;
+        double averageLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+    };
+
+    SubdivisionWorker();
+    ~SubdivisionWorker();
+    SubdivisionWorker(const SubdivisionWorker&) = delete;
+    SubdivisionWorker& operator=(const SubdivisionWorker&) = delete;
+
+    uint64_t Submit(Job job);
+
+    // Called on the worker thread, outside the lock; set it before the first Submit
+    void SetRecycler(Recycler recycler) { recycle = std::move(recycler); }
+
+    // Drops waiting work, cancels the running job and joins the thread. Called by the destructor;
+    // call it earlier when jobs reference objects that die first. Submit after Stop does nothing.
+    void Stop();
+
+    // Render thread, once per frame before updateBuffers: takes the finished result, if any
+    bool TakeResult(SubdivisionResult& out);
+
+    size_t GetQueueDepth() const;
+    Stats GetStats() const;
+
+private:
+    struct Pending {
+        uint64_t id;
+        Job job;
+        Stopwatch submitted;
+    };
+
+    void Run();
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<Pending> pending;
+    std::shared_ptr<CancelFlag> runningCancel; // null while idle
+    std::optional<SubdivisionResult> ready;
+    uint64_t nextId = 1;
+    bool stopping = false;
+    Stats stats;
+    Recycler recycle;
+    std::thread thread;
+};
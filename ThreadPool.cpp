@@ -0,0 +1,184 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace {
+std::mutex g_globalPoolMutex;
+std::unique_ptr<ThreadPool> g_globalPool;
+unsigned int g_globalPoolThreads = 0;
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    workers.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i)
+        workers.emplace_back([this]() { WorkerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task, const void* owner)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (taskCount == tasks.size()) {
+            // Unroll the ring into a larger one, oldest task first
+            std::vector<Task> grown(std::max<size_t>(16, tasks.size() * 2));
+            for (size_t i = 0; i < taskCount; ++i) grown[i] = std::move(tasks[(taskHead + i) % tasks.size()]);
+            tasks.swap(grown);
+            taskHead = 0;
+        }
+        Task& slot = tasks[(taskHead + taskCount) % tasks.size()];
+        slot.fn = std::move(task);
+        slot.owner = owner;
+        taskCount++;
+    }
+    cv.notify_one();
+}
+
+std::function<void()> ThreadPool::PopTask()
+{
+    std::function<void()> task = std::move(tasks[taskHead].fn);
+    tasks[taskHead] = Task();
+    taskHead = (taskHead + 1) % tasks.size();
+    taskCount--;
+    return task;
+}
+
+size_t ThreadPool::RemoveQueued(const void* owner)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    // Compact the ring in place, keeping the order of everything else
+    size_t kept = 0;
+    for (size_t i = 0; i < taskCount; ++i) {
+        Task& task = tasks[(taskHead + i) % tasks.size()];
+        if (task.owner == owner) {
+            task = Task();
+            continue;
+        }
+        if (kept != i) {
+            tasks[(taskHead + kept) % tasks.size()] = std::move(task);
+            task = Task();
+        }
+        kept++;
+    }
+    const size_t removed = taskCount - kept;
+    taskCount = kept;
+    return removed;
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || taskCount > 0; });
+            if (stopping && taskCount == 0) return;
+            task = PopTask();
+        }
+        task();
+    }
+}
+
+void ThreadPool::RunParallel(size_t begin, size_t end, size_t numChunks, unsigned int maxThreads, RangeFn fn, const void* context)
+{
+    if (end <= begin) return;
+    const size_t count = end - begin;
+    numChunks = std::clamp<size_t>(numChunks, 1, count);
+    if (maxThreads == 0) maxThreads = (unsigned int)workers.size() + 1;
+    if (numChunks == 1 || maxThreads == 1 || workers.empty()) {
+        fn(context, begin, end);
+        return;
+    }
+
+    struct Group {
+        RangeFn fn;
+        const void* context;
+        size_t begin, end, chunkSize, numChunks;
+        std::atomic<size_t> nextChunk;
+        std::atomic<size_t> remaining; // runner tasks not finished yet
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+
+        void RunChunk(size_t c)
+        {
+            const size_t b = begin + c * chunkSize;
+            const size_t e = std::min(end, b + chunkSize);
+            if (b >= e) return;
+            try {
+                fn(context, b, e);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+        }
+
+        // Ranges are claimed in order but keep fixed bounds, so results do not depend on who ran them
+        void RunChunks()
+        {
+            for (size_t c = nextChunk++; c < numChunks; c = nextChunk++) RunChunk(c);
+        }
+    } group;
+    group.fn = fn;
+    group.context = context;
+    group.begin = begin;
+    group.end = end;
+    group.chunkSize = (count + numChunks - 1) / numChunks;
+    group.numChunks = numChunks;
+    group.nextChunk = 0;
+    const size_t runners = std::min<size_t>(numChunks, maxThreads) - 1;
+    group.remaining = runners;
+
+    // One capture word fits std::function's inline storage, so queuing a runner does not allocate
+    Group* shared = &group;
+    for (size_t r = 0; r < runners; ++r) {
+        Enqueue([shared]() {
+            shared->RunChunks();
+            std::lock_guard<std::mutex> lock(shared->mutex);
+            if (--shared->remaining == 0) shared->done.notify_all();
+        }, shared);
+    }
+
+    group.RunChunks();
+
+    // Every chunk is claimed now. Runners still in the queue would find nothing to do, so take them
+    // back and wait only for the ones already running, which are finishing their last chunk.
+    const size_t unstarted = RemoveQueued(shared);
+    {
+        std::unique_lock<std::mutex> lock(group.mutex);
+        group.remaining -= unstarted;
+        // The last worker holds the lock while it decrements, so group outlives it
+        group.done.wait(lock, [&group]() { return group.remaining.load() == 0; });
+    }
+
+    if (group.error) std::rethrow_exception(group.error);
+}
+
+ThreadPool& ThreadPool::Global()
+{
+    std::lock_guard<std::mutex> lock(g_globalPoolMutex);
+    if (!g_globalPool) g_globalPool = std::make_unique<ThreadPool>(g_globalPoolThreads);
+    return *g_globalPool;
+}
+
+void ThreadPool::SetGlobalThreadCount(unsigned int numThreads)
+{
+    std::lock_guard<std::mutex> lock(g_globalPoolMutex);
+    if (g_globalPool && numThreads == g_globalPoolThreads) return;
+    g_globalPoolThreads = numThreads;
+    g_globalPool.reset();
+}
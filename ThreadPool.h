@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size pool of worker threads with a shared FIFO queue
+class ThreadPool {
+public:
+    // numThreads == 0 uses the hardware concurrency
+    explicit ThreadPool(unsigned int numThreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int GetThreadCount() const { return (unsigned int)workers.size(); }
+
+    template <typename F>
+    auto Submit(F&& fn) -> std::future<std::invoke_result_t<F>>
+    {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        std::future<R> result = task->get_future();
+        Enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    // Splits [begin, end) into numChunks contiguous ranges and blocks until fn ran on all of them.
+    // At most maxThreads threads (the caller included; 0: every worker plus the caller) take ranges,
+    // so the chunking does not decide the concurrency. The caller runs ranges too and then takes
+    // back the runners no worker has started, so it never waits on queued work (nesting cannot
+    // deadlock) and never runs other submitters' tasks, such as a mesh load, inside its own call.
+    // fn is only referenced, never copied, and the queue keeps its capacity, so a warm pool runs
+    // this without heap allocation.
+    template <typename F>
+    void ParallelFor(size_t begin, size_t end, size_t numChunks, F&& fn, unsigned int maxThreads = 0)
+    {
+        using Fn = std::remove_reference_t<F>;
+        RunParallel(begin, end, numChunks, maxThreads,
+            [](const void* context, size_t b, size_t e) { (*static_cast<Fn*>(const_cast<void*>(context)))(b, e); },
+            static_cast<const void*>(std::addressof(fn)));
+    }
+
+    // Process-wide pool, created on first use
+    static ThreadPool& Global();
+    // Resizes the global pool; only call while no work is in flight
+    static void SetGlobalThreadCount(unsigned int numThreads);
+
+private:
+    using RangeFn = void (*)(const void* context, size_t begin, size_t end);
+
+    void RunParallel(size_t begin, size_t end, size_t numChunks, unsigned int maxThreads, RangeFn fn, const void* context);
+    struct Task {
+        std::function<void()> fn;
+        const void* owner = nullptr; // ParallelFor group of a runner, null for Submit
+    };
+
+    void Enqueue(std::function<void()> task, const void* owner = nullptr);
+    std::function<void()> PopTask(); // caller holds mutex and checks count
+    size_t RemoveQueued(const void* owner); // drops owner's tasks no worker has taken; returns how many
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    // FIFO ring; grows by doubling and never shrinks, so a steady load does not allocate
+    std::vector<Task> tasks;
+    size_t taskHead = 0;
+    size_t taskCount = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+};
@@ -0,0 +1,161 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "Metrics.h"
+
+namespace {
+
+uint64_t steadyNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t currentThreadId()
+{
+    static std::atomic<uint32_t> nextId{ 0 };
+    thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void writeJsonString(std::ostream& out, const char* s)
+{
+    out << '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') out << '\\';
+        out << *s;
+    }
+    out << '"';
+}
+
+}
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : originNs(steadyNs()), ring(std::max<size_t>(capacity, 1))
+{
+}
+
+TraceRecorder& TraceRecorder::Global()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+uint64_t TraceRecorder::NowNs() const
+{
+    return steadyNs() - originNs;
+}
+
+void TraceRecorder::RecordSpan(const char* name, uint64_t startNs, uint64_t endNs)
+{
+    TraceEvent event;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs > startNs ? endNs - startNs : 0;
+    event.thread = currentThreadId();
+    Push(event);
+}
+
+void TraceRecorder::RecordCounter(const char* name, double value)
+{
+    TraceEvent event;
+    event.name = name;
+    event.startNs = NowNs();
+    event.value = value;
+    event.thread = currentThreadId();
+    event.counter = true;
+    Push(event);
+}
+
+void TraceRecorder::Push(const TraceEvent& event)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ring[recorded % ring.size()] = event;
+    recorded++;
+}
+
+void TraceRecorder::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    recorded = 0;
+}
+
+std::vector<TraceEvent> TraceRecorder::Snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t held = (size_t)std::min<uint64_t>(recorded, ring.size());
+    std::vector<TraceEvent> events;
+    events.reserve(held);
+    for (uint64_t i = recorded - held; i < recorded; ++i) events.push_back(ring[i % ring.size()]);
+    return events;
+}
+
+uint64_t TraceRecorder::GetRecordedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return recorded;
+}
+
+std::vector<TraceStageSummary> TraceRecorder::Summarize() const
+{
+    std::map<std::string, std::vector<double>> spans;
+    for (const TraceEvent& event : Snapshot()) {
+        if (!event.counter) spans[event.name].push_back((double)event.durationNs * 1e-6);
+    }
+
+    std::vector<TraceStageSummary> summaries;
+    summaries.reserve(spans.size());
+    for (auto& [name, samples] : spans) {
+        TraceStageSummary s;
+        s.name = name;
+        s.maxMs = *std::max_element(samples.begin(), samples.end());
+        SampleSummary percentiles = summarizeSamples(std::move(samples));
+        s.count = percentiles.count;
+        s.p50Ms = percentiles.median;
+        s.p99Ms = percentiles.p99;
+        summaries.push_back(std::move(s));
+    }
+    return summaries;
+}
+
+void TraceRecorder::PrintSummary(std::ostream& out) const
+{
+    std::vector<TraceStageSummary> summaries = Summarize();
+    if (summaries.empty()) {
+        out << "[Trace] no spans recorded\n";
+        return;
+    }
+    for (const TraceStageSummary& s : summaries) {
+        out << "[Trace] " << s.name << ": " << s.count << " spans, p50 " << s.p50Ms << " ms, p99 " << s.p99Ms
+            << " ms, max " << s.maxMs << " ms\n";
+    }
+}
+
+bool TraceRecorder::WriteChromeTrace(const std::filesystem::path& path) const
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[Trace] Error: cannot write " << path << "\n";
+        return false;
+    }
+
+    // trace_event timestamps and durations are in microseconds
+    out.precision(15);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const TraceEvent& event : Snapshot()) {
+        out << (first ? "" : ",\n") << "{\"name\": ";
+        writeJsonString(out, event.name);
+        out << ", \"pid\": 1, \"tid\": " << event.thread << ", \"ts\": " << (double)event.startNs * 1e-3;
+        if (event.counter) out << ", \"ph\": \"C\", \"args\": {\"value\": " << event.value << "}}";
+        else out << ", \"ph\": \"X\", \"dur\": " << (double)event.durationNs * 1e-3 << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
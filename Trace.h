@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Lightweight hot-path tracing: scoped spans and counters go into a fixed-size ring buffer that
+// keeps the most recent events. Recording is off until SetEnabled(true); while off, a TRACE_SCOPE
+// costs one relaxed atomic load. Building with SUBDIV_ENABLE_TRACING=0 compiles the macros out.
+#ifndef SUBDIV_ENABLE_TRACING
+#define SUBDIV_ENABLE_TRACING 1
+#endif
+
+struct TraceEvent {
+    const char* name = nullptr; // must outlive the recorder; string literals in practice
+    uint64_t startNs = 0;       // since the recorder was created
+    uint64_t durationNs = 0;    // spans only
+    double value = 0.0;         // counters only
+    uint32_t thread = 0;        // small per-thread id in first-use order
+    bool counter = false;
+};
+
+struct TraceStageSummary {
+    std::string name;
+    size_t count = 0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+class TraceRecorder {
+public:
+    static constexpr size_t kDefaultCapacity = size_t(1) << 16;
+
+    explicit TraceRecorder(size_t capacity = kDefaultCapacity);
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // Process-wide recorder, created on first use
+    static TraceRecorder& Global();
+
+    void SetEnabled(bool enabled) { this->enabled.store(enabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Both are thread-safe; once the ring is full the oldest events are overwritten
+    void RecordSpan(const char* name, uint64_t startNs, uint64_t endNs);
+    void RecordCounter(const char* name, double value);
+
+    void Clear();
+    // Events currently held, oldest first
+    std::vector<TraceEvent> Snapshot() const;
+    // Events ever recorded, including overwritten ones
+    uint64_t GetRecordedCount() const;
+
+    // Per-name span percentiles over the events still in the ring, sorted by name
+    std::vector<TraceStageSummary> Summarize() const;
+    void PrintSummary(std::ostream& out) const;
+
+    // Chrome trace_event JSON (chrome://tracing, Perfetto): spans as complete events, counters as "C"
+    bool WriteChromeTrace(const std::filesystem::path& path) const;
+
+    // Nanoseconds since this recorder was created
+    uint64_t NowNs() const;
+
+private:
+    void Push(const TraceEvent& event);
+
+    std::atomic<bool> enabled{ false };
+    const uint64_t originNs;
+
+    mutable std::mutex mutex; // guards the ring
+    std::vector<TraceEvent> ring;
+    uint64_t recorded = 0;
+};
+
+// Records [construction, destruction) as one span if tracing was enabled at construction
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) {
+        TraceRecorder& recorder = TraceRecorder::Global();
+        if (!recorder.IsEnabled()) return;
+        this->name = name;
+        startNs = recorder.NowNs();
+    }
+    ~TraceScope() {
+        if (!name) return;
+        TraceRecorder& recorder = TraceRecorder::Global();
+        recorder.RecordSpan(name, startNs, recorder.NowNs());
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name = nullptr;
+    uint64_t startNs = 0;
+};
+
+#define SUBDIV_TRACE_CONCAT_INNER(a, b) a##b
+#define SUBDIV_TRACE_CONCAT(a, b) SUBDIV_TRACE_CONCAT_INNER(a, b)
+
+#if SUBDIV_ENABLE_TRACING
+#define TRACE_SCOPE(name) TraceScope SUBDIV_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_COUNTER(name, value) \
+    do { if (TraceRecorder::Global().IsEnabled()) TraceRecorder::Global().RecordCounter(name, (double)(value)); } while (0)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_COUNTER(name, value) do {} while (0)
+#endif
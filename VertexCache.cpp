@@ -0,0 +1,149 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "Normals.h"
+
+namespace {
+
+bool indicesInRange(const std::vector<unsigned int>& indices, size_t numVerts)
+{
+    for (unsigned int i : indices) {
+        if (i >= numVerts) return false;
+    }
+    return true;
+}
+
+}
+
+VertexCacheStats simulateVertexCache(const std::vector<unsigned int>& indices, size_t numVerts, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    const size_t numTris = indices.size() / 3;
+    if (numTris == 0 || numVerts == 0) return stats;
+
+    // FIFO: a vertex inserted at miss count t is evicted once the count reaches t + cacheSize + 1
+    std::vector<int64_t> insertedAt(numVerts, std::numeric_limits<int64_t>::min() / 2);
+    std::vector<uint8_t> referenced(numVerts, 0);
+    size_t uniqueVerts = 0;
+    int64_t misses = 0;
+    for (size_t i = 0; i < numTris * 3; ++i) {
+        unsigned int v = indices[i];
+        if (v >= numVerts) continue;
+        if (!referenced[v]) {
+            referenced[v] = 1;
+            uniqueVerts++;
+        }
+        if (misses - insertedAt[v] > (int64_t)cacheSize) {
+            insertedAt[v] = misses++;
+        }
+    }
+
+    stats.misses = (size_t)misses;
+    stats.acmr = (double)misses / (double)numTris;
+    stats.atvr = uniqueVerts ? (double)misses / (double)uniqueVerts : 0.0;
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t numVerts, unsigned int cacheSize)
+{
+    const size_t numTris = indices.size() / 3;
+    if (numTris == 0 || numVerts == 0 || !indicesInRange(indices, numVerts)) return;
+
+    VertexFaceAdjacency adjacency;
+    buildVertexFaceAdjacency(indices.data(), numTris, numVerts, adjacency);
+
+    // Live (not yet emitted) triangles per vertex, cache timestamps and the dead-end stack
+    std::vector<unsigned int> live(numVerts);
+    for (size_t v = 0; v < numVerts; ++v) live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    std::vector<int64_t> cacheTime(numVerts, 0);
+    std::vector<uint8_t> emitted(numTris, 0);
+    std::vector<unsigned int> deadEnd;
+    deadEnd.reserve(numTris);
+    std::vector<unsigned int> candidates;
+    candidates.reserve(64);
+
+    std::vector<unsigned int> result;
+    result.reserve(numTris * 3);
+
+    const int64_t k = (int64_t)cacheSize;
+    int64_t time = k + 1;
+    size_t cursor = 0;     // next vertex to try once the dead-end stack runs dry
+    int64_t fanning = 0;   // vertex whose remaining triangles are emitted next
+    while (fanning >= 0) {
+        candidates.clear();
+        for (unsigned int a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; ++a) {
+            unsigned int t = adjacency.faces[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int c = 0; c < 3; ++c) {
+                unsigned int v = indices[t * 3 + c];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > k) cacheTime[v] = time++;
+            }
+        }
+
+        // Next fan: the candidate that stays in cache longest, provided its remaining fan still fits
+        fanning = -1;
+        int64_t best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * (int64_t)live[v] <= k) priority = time - cacheTime[v];
+            if (priority > best) {
+                best = priority;
+                fanning = v;
+            }
+        }
+        if (fanning >= 0) continue;
+
+        // Dead end: recently used vertices first, then scan forward for any vertex with live triangles
+        while (!deadEnd.empty() && fanning < 0) {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) fanning = v;
+        }
+        while (fanning < 0 && cursor < numVerts) {
+            if (live[cursor] > 0) fanning = (int64_t)cursor;
+            cursor++;
+        }
+    }
+
+    // Trailing indices that do not form a whole triangle stay where they were
+    result.insert(result.end(), indices.begin() + numTris * 3, indices.end());
+    indices.swap(result);
+}
+
+void buildVertexFetchRemap(const std::vector<unsigned int>& indices, size_t numVerts, std::vector<unsigned int>& remap)
+{
+    constexpr unsigned int kUnassigned = std::numeric_limits<unsigned int>::max();
+    remap.assign(numVerts, kUnassigned);
+    unsigned int next = 0;
+    for (unsigned int v : indices) {
+        if (v < numVerts && remap[v] == kUnassigned) remap[v] = next++;
+    }
+    for (size_t v = 0; v < numVerts; ++v) {
+        if (remap[v] == kUnassigned) remap[v] = next++;
+    }
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+    if (verts.empty() || indices.empty()) return;
+
+    std::vector<unsigned int> remap;
+    buildVertexFetchRemap(indices, verts.size(), remap);
+
+    std::vector<Vertex> reordered(verts.size());
+    for (size_t v = 0; v < verts.size(); ++v) reordered[remap[v]] = verts[v];
+    verts.swap(reordered);
+
+    for (unsigned int& i : indices) {
+        if (i < remap.size()) i = remap[i];
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Subdivision.h"
+
+// Post-transform cache behaviour of a triangle list under a FIFO cache of cacheSize entries
+struct VertexCacheStats {
+    double acmr = 0.0; // average cache miss ratio: transformed vertices per triangle (0.5 is ideal on big meshes)
+    double atvr = 0.0; // average transform to vertex ratio: transformed vertices per referenced vertex (1.0 is ideal)
+    size_t misses = 0;
+};
+
+// Simulates the post-transform cache over indices in draw order
+VertexCacheStats simulateVertexCache(const std::vector<unsigned int>& indices, size_t numVerts, unsigned int cacheSize = 16);
+
+// Reorders triangles for post-transform cache locality (Tipsify, linear time). Only the triangle
+// order changes; each triangle keeps its winding. A list referencing vertices >= numVerts is left unchanged.
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t numVerts, unsigned int cacheSize = 16);
+
+// Renumbers vertices in first-use order of indices so fetches walk the vertex buffer forward.
+// remap[old] = new; vertices never referenced keep their relative order after the used ones.
+void buildVertexFetchRemap(const std::vector<unsigned int>& indices, size_t numVerts, std::vector<unsigned int>& remap);
+
+// Applies buildVertexFetchRemap to verts and indices in place
+void optimizeVertexFetch(std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
@@ -0,0 +1,278 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PACKING_USE_SSE 1
+#endif
+
+#include "Parallel.h"
+
+namespace {
+
+// Below this many vertices the thread hand-off costs more than the work
+constexpr size_t kMinParallelVertices = 16384;
+
+constexpr float kUnorm16Max = 65535.0f;
+constexpr float kSnorm16Max = 32767.0f;
+
+// float -> half bit pattern, round to nearest even; overflow becomes inf, NaN stays NaN
+uint16_t floatToHalf(float value)
+{
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    const uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+
+    uint32_t o;
+    if (f >= 0x47800000u) {
+        o = f > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    }
+    else if (f < 0x38800000u) {
+        // Subnormal half: let the float adder align and round the mantissa
+        const uint32_t magicBits = 0x3f000000u;
+        float magic, sum;
+        std::memcpy(&magic, &magicBits, sizeof(magic));
+        std::memcpy(&sum, &f, sizeof(sum));
+        sum += magic;
+        std::memcpy(&o, &sum, sizeof(o));
+        o -= magicBits;
+    }
+    else {
+        const uint32_t mantissaOdd = (f >> 13) & 1u;
+        f += 0xc8000fffu; // rebias the exponent (15 - 127) and add the rounding bias
+        f += mantissaOdd;
+        o = f >> 13;
+    }
+    return (uint16_t)(o | (sign >> 16));
+}
+
+float halfToFloat(uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1fu;
+    const uint32_t mantissa = h & 0x3ffu;
+    float value;
+    if (exponent == 0) value = std::ldexp((float)mantissa, -24);
+    else if (exponent == 31) value = mantissa ? NAN : INFINITY;
+    else value = std::ldexp((float)(mantissa | 0x400u), (int)exponent - 25);
+    return sign ? -value : value;
+}
+
+float quantizeScale(float extent)
+{
+    return extent > 0.0f ? kUnorm16Max / extent : 0.0f;
+}
+
+void packScalar(const Vertex* verts, size_t begin, size_t end, const VertexPackingBounds& bounds, PackedVertex* out)
+{
+    const glm::vec3 scale(quantizeScale(bounds.extent.x), quantizeScale(bounds.extent.y), quantizeScale(bounds.extent.z));
+    for (size_t i = begin; i < end; ++i) {
+        const Vertex& v = verts[i];
+        PackedVertex& p = out[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            float q = (v.pos[axis] - bounds.min[axis]) * scale[axis];
+            q = std::min(std::max(q, 0.0f), kUnorm16Max);
+            p.pos[axis] = (uint16_t)std::nearbyint(q);
+        }
+        p.pos[3] = 0;
+
+        // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half outwards
+        const glm::vec3& n = v.normal;
+        const float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        const float inv = sum > 0.0f ? 1.0f / sum : 0.0f;
+        float ox = n.x * inv, oy = n.y * inv;
+        if (n.z < 0.0f) {
+            const float fx = (1.0f - std::fabs(oy)) * std::copysign(1.0f, ox);
+            const float fy = (1.0f - std::fabs(ox)) * std::copysign(1.0f, oy);
+            ox = fx;
+            oy = fy;
+        }
+        p.normal[0] = (int16_t)std::nearbyint(std::min(std::max(ox, -1.0f), 1.0f) * kSnorm16Max);
+        p.normal[1] = (int16_t)std::nearbyint(std::min(std::max(oy, -1.0f), 1.0f) * kSnorm16Max);
+
+        p.uv[0] = floatToHalf(v.uv.x);
+        p.uv[1] = floatToHalf(v.uv.y);
+    }
+}
+
+#if defined(PACKING_USE_SSE)
+__m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+__m128i select(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+// Four floats to half bit patterns in the low 16 bits of each lane; same steps as floatToHalf
+__m128i floatToHalf4(__m128 value)
+{
+    __m128i f = _mm_castps_si128(value);
+    const __m128i sign = _mm_and_si128(f, _mm_set1_epi32((int)0x80000000u));
+    f = _mm_xor_si128(f, sign);
+
+    const __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+    const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(f, _mm_set1_epi32((int)0xc8000fffu)), mantissaOdd), 13);
+
+    const __m128i magicBits = _mm_set1_epi32(0x3f000000);
+    const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f), _mm_castsi128_ps(magicBits))), magicBits);
+
+    // f has no sign bit left, so signed compares order it correctly
+    const __m128i infNan = select(_mm_cmpgt_epi32(f, _mm_set1_epi32(0x7f800000)), _mm_set1_epi32(0x7e00), _mm_set1_epi32(0x7c00));
+    __m128i o = select(_mm_cmplt_epi32(f, _mm_set1_epi32(0x38800000)), subnormal, normal);
+    o = select(_mm_cmpgt_epi32(f, _mm_set1_epi32(0x477fffff)), infNan, o);
+    return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+}
+
+// Packs two vectors of 0..65535 into 16-bit lanes (SSE2 only saturates signed)
+__m128i packUnsigned16(__m128i a, __m128i b)
+{
+    const __m128i bias = _mm_set1_epi32(32768);
+    return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias)), _mm_set1_epi16((short)0x8000));
+}
+
+void packSimd(const Vertex* verts, size_t begin, size_t end, const VertexPackingBounds& bounds, PackedVertex* out)
+{
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "packSimd reads a vertex as two float4");
+
+    const __m128 minX = _mm_set1_ps(bounds.min.x), minY = _mm_set1_ps(bounds.min.y), minZ = _mm_set1_ps(bounds.min.z);
+    const __m128 scaleX = _mm_set1_ps(quantizeScale(bounds.extent.x));
+    const __m128 scaleY = _mm_set1_ps(quantizeScale(bounds.extent.y));
+    const __m128 scaleZ = _mm_set1_ps(quantizeScale(bounds.extent.z));
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+    const __m128 unormMax = _mm_set1_ps(kUnorm16Max), snormMax = _mm_set1_ps(kSnorm16Max);
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u));
+
+    auto quantize = [&](__m128 p, __m128 lo, __m128 scale) {
+        __m128 q = _mm_mul_ps(_mm_sub_ps(p, lo), scale);
+        return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(q, zero), unormMax));
+    };
+    auto abs = [&](__m128 v) { return _mm_andnot_ps(signMask, v); };
+    auto copySignOne = [&](__m128 v) { return _mm_or_ps(_mm_and_ps(v, signMask), one); };
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        // Two float4 per vertex: (x y z nx) and (ny nz u v); transpose four vertices to lanes
+        const float* src = (const float*)(verts + i);
+        __m128 x = _mm_loadu_ps(src), y = _mm_loadu_ps(src + 8), z = _mm_loadu_ps(src + 16), nx = _mm_loadu_ps(src + 24);
+        __m128 ny = _mm_loadu_ps(src + 4), nz = _mm_loadu_ps(src + 12), u = _mm_loadu_ps(src + 20), v = _mm_loadu_ps(src + 28);
+        _MM_TRANSPOSE4_PS(x, y, z, nx);
+        _MM_TRANSPOSE4_PS(ny, nz, u, v);
+
+        const __m128i qx = quantize(x, minX, scaleX), qy = quantize(y, minY, scaleY), qz = quantize(z, minZ, scaleZ);
+
+        const __m128 sum = _mm_add_ps(_mm_add_ps(abs(nx), abs(ny)), abs(nz));
+        const __m128 inv = _mm_and_ps(_mm_div_ps(one, sum), _mm_cmpgt_ps(sum, zero));
+        __m128 ox = _mm_mul_ps(nx, inv), oy = _mm_mul_ps(ny, inv);
+        const __m128 fx = _mm_mul_ps(_mm_sub_ps(one, abs(oy)), copySignOne(ox));
+        const __m128 fy = _mm_mul_ps(_mm_sub_ps(one, abs(ox)), copySignOne(oy));
+        const __m128 lower = _mm_cmplt_ps(nz, zero);
+        ox = select(lower, fx, ox);
+        oy = select(lower, fy, oy);
+        const __m128i sx = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(ox, minusOne), one), snormMax));
+        const __m128i sy = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(oy, minusOne), one), snormMax));
+
+        const __m128i hu = floatToHalf4(u), hv = floatToHalf4(v);
+
+        // Interleave the 16-bit lanes back into records of (x y z 0 | nx ny u v)
+        const __m128i xy = packUnsigned16(qx, qy);
+        const __m128i z0 = packUnsigned16(qz, _mm_setzero_si128());
+        const __m128i n = _mm_packs_epi32(sx, sy);
+        const __m128i uv = packUnsigned16(hu, hv);
+        const __m128i xz = _mm_unpacklo_epi16(xy, z0), y0 = _mm_unpackhi_epi16(xy, z0);
+        const __m128i posLo = _mm_unpacklo_epi16(xz, y0), posHi = _mm_unpackhi_epi16(xz, y0);
+        const __m128i nu = _mm_unpacklo_epi16(n, uv), nv = _mm_unpackhi_epi16(n, uv);
+        const __m128i attrLo = _mm_unpacklo_epi16(nu, nv), attrHi = _mm_unpackhi_epi16(nu, nv);
+
+        __m128i* dst = (__m128i*)(out + i);
+        _mm_storeu_si128(dst, _mm_unpacklo_epi64(posLo, attrLo));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi64(posLo, attrLo));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi64(posHi, attrHi));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi64(posHi, attrHi));
+    }
+    packScalar(verts, i, end, bounds, out);
+}
+#else
+void packSimd(const Vertex* verts, size_t begin, size_t end, const VertexPackingBounds& bounds, PackedVertex* out)
+{
+    packScalar(verts, begin, end, bounds, out);
+}
+#endif
+
+}
+
+VertexPackingBounds computePackingBounds(const Vertex* verts, size_t count, unsigned int numThreads)
+{
+    VertexPackingBounds bounds;
+    if (count == 0) return bounds;
+
+    glm::vec3 lo = verts[0].pos, hi = verts[0].pos;
+    std::mutex mutex;
+    parallelFor(0, count, [&](size_t begin, size_t end) {
+        glm::vec3 chunkLo = verts[begin].pos, chunkHi = verts[begin].pos;
+        for (size_t i = begin + 1; i < end; ++i) {
+            chunkLo = glm::min(chunkLo, verts[i].pos);
+            chunkHi = glm::max(chunkHi, verts[i].pos);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        lo = glm::min(lo, chunkLo);
+        hi = glm::max(hi, chunkHi);
+    }, count < kMinParallelVertices ? 1 : numThreads);
+
+    bounds.min = lo;
+    bounds.extent = hi - lo;
+    return bounds;
+}
+
+void packVertices(const Vertex* verts, size_t count, const VertexPackingBounds& bounds, PackedVertex* out, unsigned int numThreads)
+{
+    parallelFor(0, count, [&](size_t begin, size_t end) {
+        packSimd(verts, begin, end, bounds, out);
+    }, count < kMinParallelVertices ? 1 : numThreads);
+}
+
+void packVerticesReference(const Vertex* verts, size_t count, const VertexPackingBounds& bounds, PackedVertex* out)
+{
+    packScalar(verts, 0, count, bounds, out);
+}
+
+void unpackVertices(const PackedVertex* packed, size_t count, const VertexPackingBounds& bounds, Vertex* out)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const PackedVertex& p = packed[i];
+        Vertex& v = out[i];
+        for (int axis = 0; axis < 3; ++axis)
+            v.pos[axis] = bounds.min[axis] + (float)p.pos[axis] / kUnorm16Max * bounds.extent[axis];
+
+        glm::vec3 n(std::max(p.normal[0] / kSnorm16Max, -1.0f), std::max(p.normal[1] / kSnorm16Max, -1.0f), 0.0f);
+        n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+        const float t = std::max(-n.z, 0.0f);
+        n.x += n.x >= 0.0f ? -t : t;
+        n.y += n.y >= 0.0f ? -t : t;
+        v.normal = glm::normalize(n);
+
+        v.uv = glm::vec2(halfToFloat(p.uv[0]), halfToFloat(p.uv[1]));
+    }
+}
+
+VertexPackingError measurePackingError(const Vertex* verts, const PackedVertex* packed, size_t count, const VertexPackingBounds& bounds)
+{
+    VertexPackingError error;
+    Vertex decoded;
+    for (size_t i = 0; i < count; ++i) {
+        unpackVertices(packed + i, 1, bounds, &decoded);
+        const Vertex& v = verts[i];
+        error.maxPosition = std::max(error.maxPosition, glm::length(decoded.pos - v.pos));
+        error.maxUv = std::max(error.maxUv, std::max(std::fabs(decoded.uv.x - v.uv.x), std::fabs(decoded.uv.y - v.uv.y)));
+        const float length = glm::length(v.normal);
+        if (length > 0.0f) {
+            // atan2 keeps small angles accurate where acos of a float cosine cannot resolve them
+            const glm::vec3 n = v.normal / length;
+            const float angle = std::atan2(glm::length(glm::cross(n, decoded.normal)), glm::dot(n, decoded.normal));
+            error.maxNormalDegrees = std::max(error.maxNormalDegrees, angle * (180.0f / 3.14159265f));
+        }
+    }
+    const float diagonal = glm::length(bounds.extent);
+    error.maxPositionRelative = diagonal > 0.0f ? error.maxPosition / diagonal : 0.0f;
+    return error;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Subdivision.h"
+
+// 16-byte render vertex: position as unorm16 within the mesh bounds (pos[3] unused, keeps the
+// record aligned), octahedral normal as snorm16 and uv as half floats. Decoded by the vertex shader
+// with GL normalized attributes: position = boundsMin + pos * boundsExtent.
+struct PackedVertex {
+    uint16_t pos[4];
+    int16_t normal[2];
+    uint16_t uv[2];
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+struct VertexPackingBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 extent = glm::vec3(0.0f); // max - min; a flat axis quantizes to 0
+};
+
+// Worst round-trip error over a packed buffer
+struct VertexPackingError {
+    float maxPosition = 0.0f;      // same units as the positions
+    float maxPositionRelative = 0.0f; // divided by the bounds diagonal
+    float maxNormalDegrees = 0.0f; // between the normalized source normal and the decoded one
+    float maxUv = 0.0f;
+};
+
+VertexPackingBounds computePackingBounds(const Vertex* verts, size_t count, unsigned int numThreads = 0);
+
+// Encodes four vertices per step with SSE2 (also in AVX2 builds), scalar code otherwise; split
+// across the global thread pool. Bit-identical to packVerticesReference. numThreads == 0 uses all workers.
+void packVertices(const Vertex* verts, size_t count, const VertexPackingBounds& bounds, PackedVertex* out, unsigned int numThreads = 0);
+
+// Scalar encoder, one vertex at a time
+void packVerticesReference(const Vertex* verts, size_t count, const VertexPackingBounds& bounds, PackedVertex* out);
+
+// Decodes like the packed vertex shader
+void unpackVertices(const PackedVertex* packed, size_t count, const VertexPackingBounds& bounds, Vertex* out);
+
+VertexPackingError measurePackingError(const Vertex* verts, const PackedVertex* packed, size_t count, const VertexPackingBounds& bounds);
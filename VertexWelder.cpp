@@ -0,0 +1,250 @@
+#include "VertexWelder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "Parallel.h"
+#include "Trace.h"
+
+namespace {
+
+constexpr unsigned int kNone = std::numeric_limits<unsigned int>::max();
+
+// Cells are a few epsilons wide so most points only need their own cell; neighbours are
+// probed only along axes where the point lies within epsilon of the cell border.
+constexpr double kCellScale = 4.0;
+
+inline uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+struct BitKey {
+    uint32_t x, y, z;
+    bool operator==(const BitKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+inline BitKey bitKey(const glm::vec3& p)
+{
+    BitKey k;
+    // +0.0f folds -0.0f into the same key
+    float x = p.x + 0.0f, y = p.y + 0.0f, z = p.z + 0.0f;
+    std::memcpy(&k.x, &x, 4);
+    std::memcpy(&k.y, &y, 4);
+    std::memcpy(&k.z, &z, 4);
+    return k;
+}
+
+inline uint64_t hashKey(const BitKey& k)
+{
+    return mix64(((uint64_t)k.x << 32 | k.y) ^ mix64(k.z));
+}
+
+struct Cell {
+    int64_t x, y, z;
+    bool operator==(const Cell& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+inline uint64_t hashCell(const Cell& c)
+{
+    return mix64((uint64_t)c.x * 0x9E3779B97F4A7C15ull ^ (uint64_t)c.y * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)c.z);
+}
+
+// Open-addressing (linear probing) map with a power-of-two capacity
+template <typename KeyT>
+class ProbeTable {
+public:
+    void Init(size_t expected)
+    {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        slots.assign(capacity, Slot{ KeyT{}, kNone });
+        mask = capacity - 1;
+    }
+
+    // Returns the stored value, inserting value if the key is new
+    unsigned int FindOrInsert(const KeyT& key, uint64_t hash, unsigned int value)
+    {
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& s = slots[i];
+            if (s.value == kNone) { s.key = key; s.value = value; return value; }
+            if (s.key == key) return s.value;
+        }
+    }
+
+    unsigned int Find(const KeyT& key, uint64_t hash) const
+    {
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& s = slots[i];
+            if (s.value == kNone) return kNone;
+            if (s.key == key) return s.value;
+        }
+    }
+
+    void Set(const KeyT& key, uint64_t hash, unsigned int value)
+    {
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            Slot& s = slots[i];
+            if (s.value == kNone || s.key == key) { s.key = key; s.value = value; return; }
+        }
+    }
+
+private:
+    struct Slot {
+        KeyT key;
+        unsigned int value;
+    };
+    std::vector<Slot> slots;
+    size_t mask = 0;
+};
+
+// Pass 1: bit-exact duplicates. firstCorner[i] is the lowest corner with the same position as i.
+// Keys are independent, so in parallel mode corners are bucketed into shards by the high hash
+// bits with a stable counting sort and every shard is resolved by one thread in corner order.
+void findExactDuplicates(const glm::vec3* positions, size_t count, unsigned int numThreads, std::vector<unsigned int>& firstCorner)
+{
+    std::vector<BitKey> keys(count);
+    std::vector<uint64_t> hashes(count);
+    parallelFor(0, count, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            keys[i] = bitKey(positions[i]);
+            hashes[i] = hashKey(keys[i]);
+        }
+    }, numThreads);
+
+    firstCorner.resize(count);
+    if (numThreads <= 1) {
+        ProbeTable<BitKey> table;
+        table.Init(count);
+        for (size_t i = 0; i < count; ++i) firstCorner[i] = table.FindOrInsert(keys[i], hashes[i], (unsigned int)i);
+        return;
+    }
+
+    int shardBits = 0;
+    while ((1u << shardBits) < numThreads * 4) ++shardBits;
+    const size_t numShards = (size_t)1 << shardBits;
+    auto shardOf = [shardBits](uint64_t h) { return (size_t)(h >> (64 - shardBits)); };
+
+    const size_t numChunks = numThreads;
+    const size_t chunkSize = (count + numChunks - 1) / numChunks;
+    std::vector<size_t> offsets(numChunks * numShards, 0);
+    parallelFor(0, numChunks, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c) {
+            size_t* hist = &offsets[c * numShards];
+            for (size_t i = c * chunkSize; i < std::min(count, (c + 1) * chunkSize); ++i) hist[shardOf(hashes[i])]++;
+        }
+    }, numThreads);
+
+    // Shard-major, chunk-minor prefix sum keeps ascending corner order inside each shard
+    std::vector<size_t> shardBegin(numShards + 1, 0);
+    size_t running = 0;
+    for (size_t s = 0; s < numShards; ++s) {
+        shardBegin[s] = running;
+        for (size_t c = 0; c < numChunks; ++c) {
+            size_t n = offsets[c * numShards + s];
+            offsets[c * numShards + s] = running;
+            running += n;
+        }
+    }
+    shardBegin[numShards] = running;
+
+    std::vector<unsigned int> sorted(count);
+    parallelFor(0, numChunks, [&](size_t cb, size_t ce) {
+        for (size_t c = cb; c < ce; ++c) {
+            size_t* offs = &offsets[c * numShards];
+            for (size_t i = c * chunkSize; i < std::min(count, (c + 1) * chunkSize); ++i)
+                sorted[offs[shardOf(hashes[i])]++] = (unsigned int)i;
+        }
+    }, numThreads);
+
+    parallelFor(0, numShards, [&](size_t sb, size_t se) {
+        ProbeTable<BitKey> table;
+        for (size_t s = sb; s < se; ++s) {
+            table.Init(shardBegin[s + 1] - shardBegin[s]);
+            for (size_t k = shardBegin[s]; k < shardBegin[s + 1]; ++k) {
+                unsigned int i = sorted[k];
+                firstCorner[i] = table.FindOrInsert(keys[i], hashes[i], i);
+            }
+        }
+    }, numThreads);
+}
+
+} // namespace
+
+void weldPositions(const glm::vec3* positions, size_t count, const WeldOptions& options,
+    std::vector<unsigned int>& remap, std::vector<glm::vec3>& uniquePositions)
+{
+    remap.assign(count, 0);
+    uniquePositions.clear();
+    if (count == 0) return;
+    TRACE_SCOPE("weld");
+
+    const float eps = options.epsilon > 0.0f ? options.epsilon : 1e-6f;
+    const float eps2 = eps * eps;
+    const unsigned int numThreads = options.parallel ? (options.numThreads ? options.numThreads : defaultThreadCount()) : 1;
+
+    std::vector<unsigned int> firstCorner;
+    findExactDuplicates(positions, count, numThreads, firstCorner);
+
+    // Distinct positions in order of first occurrence
+    std::vector<unsigned int> distinct;
+    for (size_t i = 0; i < count; ++i)
+        if (firstCorner[i] == i) distinct.push_back((unsigned int)i);
+
+    // Pass 2: near duplicates among distinct positions. Each cell holds a chain of the vertices
+    // created inside it; a position joins the lowest-numbered vertex within epsilon, else starts a new one.
+    const double cellSize = eps * kCellScale;
+    const double invCellSize = 1.0 / cellSize;
+    ProbeTable<Cell> cellHeads;
+    cellHeads.Init(distinct.size());
+    std::vector<unsigned int> chainNext;
+    chainNext.reserve(distinct.size());
+
+    std::vector<unsigned int> cornerVertex(count, kNone);
+    for (unsigned int corner : distinct) {
+        const glm::vec3 p = positions[corner];
+        double fx = p.x * invCellSize, fy = p.y * invCellSize, fz = p.z * invCellSize;
+        Cell c{ (int64_t)std::floor(fx), (int64_t)std::floor(fy), (int64_t)std::floor(fz) };
+
+        // Probe range per axis: the neighbour cell only if p is within epsilon of that border
+        const double border = 1.0 / kCellScale;
+        int lo[3], hi[3];
+        double frac[3] = { fx - (double)c.x, fy - (double)c.y, fz - (double)c.z };
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = frac[a] < border ? -1 : 0;
+            hi[a] = frac[a] > 1.0 - border ? 1 : 0;
+        }
+
+        unsigned int best = kNone;
+        for (int dz = lo[2]; dz <= hi[2]; ++dz)
+            for (int dy = lo[1]; dy <= hi[1]; ++dy)
+                for (int dx = lo[0]; dx <= hi[0]; ++dx) {
+                    Cell n{ c.x + dx, c.y + dy, c.z + dz };
+                    for (unsigned int v = cellHeads.Find(n, hashCell(n)); v != kNone; v = chainNext[v]) {
+                        if (v >= best) continue;
+                        glm::vec3 d = uniquePositions[v] - p;
+                        if (glm::dot(d, d) <= eps2) best = v;
+                    }
+                }
+
+        if (best == kNone) {
+            best = (unsigned int)uniquePositions.size();
+            uniquePositions.push_back(p);
+            uint64_t h = hashCell(c);
+            chainNext.push_back(cellHeads.Find(c, h));
+            cellHeads.Set(c, h, best);
+        }
+        cornerVertex[corner] = best;
+    }
+
+    parallelFor(0, count, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) remap[i] = cornerVertex[firstCorner[i]];
+    }, numThreads);
+}
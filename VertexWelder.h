@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct WeldOptions {
+    float epsilon = 1e-6f;
+    bool parallel = false;      // worth it from roughly a million corners up
+    unsigned int numThreads = 0; // 0: hardware concurrency
+};
+
+// Merges positions closer than epsilon in O(n). Bit-exact duplicates are collapsed first through an
+// open-addressing hash table (sharded across threads in parallel mode), then the distinct positions
+// are matched against a quantized spatial hash, probing neighbour cells only near cell borders.
+// The result depends only on the input order, never on thread timing: remap[i] is the welded
+// vertex of corner i and unique vertices are numbered in order of first occurrence.
+void weldPositions(const glm::vec3* positions, size_t count, const WeldOptions& options,
+    std::vector<unsigned int>& remap, std::vector<glm::vec3>& uniquePositions);
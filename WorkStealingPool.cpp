@@ -0,0 +1,117 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// Which pool and deque the calling thread works for
+thread_local const WorkStealingPool* t_pool = nullptr;
+thread_local unsigned int t_worker = 0;
+
+}
+
+WorkStealingPool::WorkStealingPool(unsigned int numThreads)
+{
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    queues.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i) queues.push_back(std::make_unique<Queue>());
+    threads.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i)
+        threads.emplace_back([this, i]() { WorkerLoop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    WaitIdle();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+int WorkStealingPool::CurrentWorker() const
+{
+    return t_pool == this ? (int)t_worker : -1;
+}
+
+void WorkStealingPool::Submit(std::function<void()> task)
+{
+    const int self = CurrentWorker();
+    const size_t target = self >= 0 ? (size_t)self : nextQueue.fetch_add(1) % queues.size();
+    pending++;
+    // Counted under the sleep lock, before the push, so a worker that just found every deque empty
+    // cannot miss it and a pop never runs ahead of the count
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::TryPop(unsigned int self, std::function<void()>& task)
+{
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued--;
+        stolen++;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::WorkerLoop(unsigned int self)
+{
+    t_pool = this;
+    t_worker = self;
+    for (;;) {
+        std::function<void()> task;
+        if (TryPop(self, task)) {
+            task();
+            task = nullptr;
+            executed++;
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
+
+void WorkStealingPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return pending.load() == 0; });
+}
+
+WorkStealingPool::Stats WorkStealingPool::GetStats() const
+{
+    Stats stats;
+    stats.executed = executed.load();
+    stats.stolen = stolen.load();
+    return stats;
+}
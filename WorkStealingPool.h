@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool for many independent jobs of uneven size. Every worker owns a deque: tasks submitted from a
+// worker go to the back of its own deque and it pops from the back, so a job's follow-up stage
+// runs next on the same core while its data is still hot. An idle worker steals the oldest task
+// from the front of another worker's deque. Tasks submitted from outside are dealt round-robin.
+class WorkStealingPool {
+public:
+    struct Stats {
+        size_t executed = 0;
+        size_t stolen = 0;
+    };
+
+    // numThreads == 0 uses the hardware concurrency
+    explicit WorkStealingPool(unsigned int numThreads = 0);
+    // Runs what is still queued, then joins the workers
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned int GetThreadCount() const { return (unsigned int)threads.size(); }
+
+    void Submit(std::function<void()> task);
+
+    // Blocks until every submitted task, including tasks they submitted, has finished. Not from a task.
+    void WaitIdle();
+
+    // Index of the calling worker in [0, GetThreadCount()), or -1 off the pool
+    int CurrentWorker() const;
+
+    Stats GetStats() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool TryPop(unsigned int self, std::function<void()>& task);
+    void WorkerLoop(unsigned int self);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex; // guards stopping and the sleep/idle waits
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping = false;
+    std::atomic<size_t> queued{ 0 };  // in some deque
+    std::atomic<size_t> pending{ 0 }; // submitted and not finished
+    std::atomic<size_t> nextQueue{ 0 };
+    std::atomic<size_t> executed{ 0 };
+    std::atomic<size_t> stolen{ 0 };
+};
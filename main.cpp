@@ -5,6 +5,8 @@
 #include <iostream>
 #include <algorithm>
 #include <map>
+#include <optional>
+#include <cstdio>
 
 #define GLAD_GL_IMPLEMENTATION
 #include <glad/glad.h>
@@ -15,35 +17,76 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <opensubdiv/far/topologyDescriptor.h>
-#include <opensubdiv/far/topologyRefinerFactory.h>
-#include <opensubdiv/far/primvarRefiner.h>
-
+#include "AdaptiveSubdivision.h"
+#include "AnimatedSubdivision.h"
+#include "IncrementalSubdivision.h"
+#include "StreamingSubdivision.h"
 #include "ResourceManager.h"
-
-typedef struct Vertex
-{
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec2 uv;
-    void Clear(void* = 0) { pos = glm::vec3(0); normal = glm::vec3(0); uv = glm::vec2(0); }
-    void AddWithWeight(const Vertex& src, float weight) { pos += src.pos * weight; normal += src.normal * weight; uv += src.uv * weight; }
-} Vertex;
+#include "Subdivision.h"
+#include "SubdivisionArena.h"
+#include "SubdivisionCache.h"
+#include "SubdivisionWorker.h"
+#include "Trace.h"
+#include "VertexCache.h"
+#include "VertexPacking.h"
+#include "MeshPrimitives.h"
 
 std::shared_ptr<MeshData> g_currentMesh;
 
 std::vector<Vertex> g_renderVerts;
 std::vector<unsigned int> g_renderIndices;
+// 'P' uploads 16-byte packed vertices instead of 32-byte floats; the shader decodes them with these bounds
+bool g_packVertices = false;
+std::vector<PackedVertex> g_renderPacked;
+VertexPackingBounds g_renderBounds;
 
 GLuint g_vao, g_vbo, g_ebo;
 int g_currentLevel = 0; // Subdivision level (0~5)
 
 bool g_showWireframe = false;
+bool g_useLimitSurface = false; // limit positions + tangent normals instead of face-averaged normals
+
+bool g_useAdaptive = false;     // feature-adaptive patches tessellated to a triangle budget
+size_t g_adaptiveBudget = 1000000;
+
+bool g_useIncremental = true;   // step between levels from retained ones instead of re-running stencils from the cage
+const size_t INCREMENTAL_RETAINED_LEVELS = 3;
+
+bool g_useStreaming = false;    // two live levels at a time, nothing retained between requests
+const size_t STREAMING_MEMORY_BUDGET = size_t(4) << 30;
+
+bool g_optimizeDrawOrder = true; // reorder triangles for the post-transform cache, then vertices for fetch
+
+// 'D' deforms the cage every frame: topology and stencils come from the worker once per mesh/level,
+// the render thread re-evaluates them and refreshes the vertex buffer in place
+bool g_animate = false;
+std::unique_ptr<AnimatedSubdivision> g_animated;
+CageDeformer g_deformer;
+
+// 'T' starts/stops recording; stopping prints per-stage p50/p99 and writes a Chrome trace
+const char* const TRACE_OUTPUT_PATH = "subdiv_trace.json";
+std::string g_frameStats;        // frame p50/p99 shown in the title while recording
+
+// Subdivision runs on this worker; everything below it is only touched from its jobs
+SubdivisionWorker g_subdivWorker;
+SubdivisionCache g_subdivCache;
+// Output buffers circulate between the worker and the render thread instead of being freed, and
+// evaluation scratch is kept, so revisiting levels does not allocate (Acquire/Release are thread-safe)
+SubdivisionArena g_subdivArena;
+int g_workerModelIndex = -1;
+std::shared_ptr<MeshData> g_workerMesh;
+std::unique_ptr<AdaptiveTopology> g_adaptiveTopology;
+std::weak_ptr<MeshData> g_adaptiveMesh;
+std::unique_ptr<IncrementalSubdivision> g_incremental;
+std::shared_ptr<MeshData> g_workerTriangulated; // fan-split copy of g_workerMesh for Loop on a polygonal cage
 
 
 int g_modelIndex = 0;   // 0: Bunny, 1: Suzanne, 2:original_bunny, 3: Cube
 const int MAX_MODELS = 4;
 
+// Per-model scheme; empty picks Loop for triangle cages and Catmull-Clark otherwise ('C' cycles)
+std::optional<OpenSubdiv::Sdc::SchemeType> g_modelScheme[MAX_MODELS];
+
 bool g_leftMouseDown = false;
 bool g_rightMouseDown = false;
 double g_lastX = 0.0f;
@@ -52,184 +95,369 @@ float g_rotX = 0.0f;
 float g_rotY = 0.0f;
 float g_cameraDist = 3.0f;
 
-void updateMeshSubdivsion(int level);
-void updateBuffers();
-void createCube(std::shared_ptr<MeshData>& mesh);
-void loadModelData(int index, ResourceManager& resourceMgr);
+using CancelFlag = SubdivisionWorker::CancelFlag;
+
+// Finished adaptive or reordered worker output, kept in the ResourceManager's derived cache so revisiting it is a copy
+struct SubdividedMesh {
+    std::vector<Vertex> verts;
+    std::vector<unsigned int> indices;
+};
+// DerivedKey::kind of a SubdividedMesh; the adaptive triangle budget goes into the variant
+enum SubdividedKind : uint32_t {
+    SUBDIVIDED_UNIFORM = 0,
+    SUBDIVIDED_LIMIT = 1,
+    SUBDIVIDED_ADAPTIVE = 2,
+    SUBDIVIDED_ORDERED = 1u << 8, // or-ed with one of the above
+};
+const size_t RESOURCE_MEMORY_BUDGET = size_t(2) << 30;
+
+void requestSubdivision(ResourceManager& resMgr);
+std::shared_ptr<MeshData> loadModelData(int index, ResourceManager& resourceMgr);
+const char* modelName(int index);
+bool updateMeshSubdivsion(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, bool useLimit, const CancelFlag& cancelled, SubdivisionResult& result);
+bool updateIncrementalSubdivision(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, bool useLimit, const CancelFlag& cancelled, SubdivisionResult& result);
+bool updateStreamingSubdivision(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, const CancelFlag& cancelled, SubdivisionResult& result);
+bool updateAdaptiveSubdivision(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int isolationLevel, size_t budget, const CancelFlag& cancelled, SubdivisionResult& result);
+void optimizeDrawOrder(SubdivisionResult& result);
+void packResult(SubdivisionResult& result);
+void updateBuffers(GLenum usage = GL_STATIC_DRAW);
+void updateAnimatedVertices(float time);
+void updateWindowTitle(GLFWwindow* window);
+void stopTracing();
+
+// Queues the current model/level/mode on the worker; the previous geometry stays on screen until it finishes
+void requestSubdivision(ResourceManager& resMgr)
+{
+    int modelIndex = g_modelIndex;
+    int level = g_currentLevel;
+    bool useLimit = g_useLimitSurface;
+    bool useAdaptive = g_useAdaptive;
+    bool useIncremental = g_useIncremental;
+    bool useStreaming = g_useStreaming;
+    bool optimizeOrder = g_optimizeDrawOrder;
+    size_t budget = g_adaptiveBudget;
+    std::optional<OpenSubdiv::Sdc::SchemeType> schemeChoice = g_modelScheme[modelIndex];
+    bool animate = g_animate;
+    bool pack = g_packVertices;
+
+    g_subdivWorker.Submit([&resMgr, modelIndex, level, useLimit, useAdaptive, useIncremental, useStreaming, optimizeOrder, budget, schemeChoice, animate, pack](const CancelFlag& cancelled, SubdivisionResult& result) {
+        using namespace OpenSubdiv;
+        TRACE_SCOPE("subdivide");
+        if (modelIndex != g_workerModelIndex || !g_workerMesh) {
+            g_workerMesh = loadModelData(modelIndex, resMgr);
+            g_workerModelIndex = modelIndex;
+            g_workerTriangulated.reset();
+        }
+        if (!g_workerMesh || cancelled) return false;
 
-// Testing cube
-void createCube(std::shared_ptr<MeshData>& mesh) {
-    std::vector<glm::vec3> p = {
-        {-0.5f,-0.5f, 0.5f}, { 0.5f,-0.5f, 0.5f}, { 0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f},
-        {-0.5f,-0.5f,-0.5f}, { 0.5f,-0.5f,-0.5f}, { 0.5f, 0.5f,-0.5f}, {-0.5f, 0.5f,-0.5f}
-    };
-    std::vector<unsigned int> idx = {
-        0,1,2, 2,3,0,  1,5,6, 6,2,1,  5,4,7, 7,6,5,
-        4,0,3, 3,7,4,  3,2,6, 6,7,3,  4,5,1, 1,0,4
-    };
+        result.mesh = g_workerMesh;
+        result.level = level;
 
-    mesh->vertices = p;
-    mesh->indices = idx;
-    for(auto& v : p) {
-        mesh->normals.push_back(glm::vec3(0,0,0));
-        mesh->uvs.push_back(glm::vec2(0,0));
-    }
-    for(int i=0; i<12; ++i)
-        mesh->vertsPerFace.push_back(3);
-
-    for (size_t i = 0; i < mesh->indices.size(); i += 3) {
-        unsigned int i0 = mesh->indices[i];
-        unsigned int i1 = mesh->indices[i+1];
-        unsigned int i2 = mesh->indices[i+2];
-        glm::vec3 v0 = mesh->vertices[i0];
-        glm::vec3 v1 = mesh->vertices[i1];
-        glm::vec3 v2 = mesh->vertices[i2];
-        glm::vec3 crossP = glm::cross(v1 - v0, v2 - v0);
-        if (glm::length(crossP) > 1e-10f) {
-            mesh->normals[i0] += crossP; mesh->normals[i1] += crossP; mesh->normals[i2] += crossP;
+        // Polygons stay polygons through refinement; only Loop needs the cage split into triangles first
+        Sdc::SchemeType scheme = schemeChoice ? *schemeChoice : defaultScheme(*g_workerMesh);
+        std::shared_ptr<MeshData> mesh = g_workerMesh;
+        if (scheme == Sdc::SCHEME_LOOP && !isTriangleMesh(*mesh)) {
+            if (!g_workerTriangulated) g_workerTriangulated = triangulateMesh(*mesh);
+            mesh = g_workerTriangulated;
+        }
+
+        // Animation only needs the stencils of the cage actually refined; the render thread does the rest
+        if (animate) {
+            result.mesh = mesh;
+            result.animated = true;
+            if (level > 0) {
+                result.topology = g_subdivCache.Acquire(mesh, scheme, level);
+                if (!result.topology) return false;
+            }
+            return !cancelled;
+        }
+
+        // Uniform and limit levels are rebuilt from SubdivisionCache or the retained levels in about the
+        // time a copy takes, so only adaptive tessellations and reordered output are kept as derived
+        // products. Streaming keeps nothing, since a copy would defeat its memory budget.
+        const bool adaptive = useAdaptive && level > 0;
+        const bool keepDerived = adaptive || (optimizeOrder && !(useStreaming && level > 0));
+
+        // Everything that changes the output goes into the key
+        uint32_t kind = SUBDIVIDED_UNIFORM;
+        if (adaptive) kind = SUBDIVIDED_ADAPTIVE;
+        else if (useLimit && !useStreaming && level > 0) kind = SUBDIVIDED_LIMIT;
+        if (optimizeOrder) kind |= SUBDIVIDED_ORDERED;
+        DerivedKey key(modelName(modelIndex), (int)scheme, level, kind, adaptive ? budget : 0);
+        if (auto cached = keepDerived ? resMgr.FindDerived<SubdividedMesh>(key) : nullptr) {
+            result.verts = g_subdivArena.AcquireVertices(cached->verts.size());
+            result.indices = g_subdivArena.AcquireIndices(cached->indices.size());
+            std::copy(cached->verts.begin(), cached->verts.end(), result.verts.begin());
+            std::copy(cached->indices.begin(), cached->indices.end(), result.indices.begin());
+            if (pack) packResult(result);
+            return true;
+        }
+
+        bool ok;
+        if (adaptive)
+            ok = updateAdaptiveSubdivision(mesh, scheme, level, budget, cancelled, result);
+        else if (useStreaming && level > 0)
+            ok = updateStreamingSubdivision(mesh, scheme, level, cancelled, result);
+        else if (useIncremental && level > 0)
+            ok = updateIncrementalSubdivision(mesh, scheme, level, useLimit, cancelled, result);
+        else
+            ok = updateMeshSubdivsion(mesh, scheme, level, useLimit, cancelled, result);
+        if (!ok || cancelled) return false;
+
+        if (optimizeOrder) optimizeDrawOrder(result);
+
+        if (keepDerived) {
+            auto product = std::make_shared<SubdividedMesh>();
+            product->verts = result.verts;
+            product->indices = result.indices;
+            size_t bytes = product->verts.capacity() * sizeof(Vertex) + product->indices.capacity() * sizeof(unsigned int);
+            resMgr.PutDerived<SubdividedMesh>(key, std::move(product), bytes);
         }
+        if (pack) packResult(result);
+
+        ResourceManager::CacheStats stats = resMgr.GetCacheStats();
+        std::cout << "[ResourceManager] meshes " << stats.meshHits << "/" << stats.meshMisses
+                  << ", derived " << stats.derivedHits << "/" << stats.derivedMisses << " (hits/misses), evictions: " << stats.evictions
+                  << ", " << stats.bytes / (1024 * 1024) << " MB of " << stats.budget / (1024 * 1024) << " MB ("
+                  << stats.pinnedBytes / (1024 * 1024) << " MB pinned)\n";
+        return true;
+    });
+}
+
+const char* modelName(int index)
+{
+    switch (index) {
+    case 0: return "bunny";
+    case 1: return "suzanne";
+    case 2: return "original_bunny";
+    default: return "cube";
     }
-    for (auto& n : mesh->normals)
-        if(glm::length(n)>0)
-            n = glm::normalize(n);
 }
 
 // Load models
-void loadModelData(int index, ResourceManager& resMgr) {
+std::shared_ptr<MeshData> loadModelData(int index, ResourceManager& resMgr) {
+    std::shared_ptr<MeshData> mesh;
     if (index == 0) {
-		g_currentMesh = resMgr.GetMesh("bunny");
+		mesh = resMgr.GetMesh("bunny");
     } 
     else if (index == 1) {
-		g_currentMesh = resMgr.GetMesh("suzanne");
+		mesh = resMgr.GetMesh("suzanne");
     }
     else if (index == 2) {
-		g_currentMesh = resMgr.GetMesh("original_bunny");
+		mesh = resMgr.GetMesh("original_bunny");
     }
     else {
-        createCube(g_currentMesh);
+        createCube(mesh);
     }
-
-    g_currentLevel = 0;
-    updateMeshSubdivsion(0);
+    return mesh;
 }
 
-void updateMeshSubdivsion(int level)
+bool updateMeshSubdivsion(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, bool useLimit, const CancelFlag& cancelled, SubdivisionResult& result)
 {
     using namespace OpenSubdiv;
 
-    g_renderVerts.clear();
-    g_renderIndices.clear();
-
     // Level 0:  BaseMesh
     if (level <= 0) {
-        for (size_t i = 0; i < g_currentMesh->vertices.size(); ++i) {
-            Vertex vert;
-            vert.pos = g_currentMesh->vertices[i];
-            vert.normal = g_currentMesh->normals[i]; 
-            vert.uv = g_currentMesh->uvs[i];
-            g_renderVerts.push_back(vert);
-        }
-        g_renderIndices = g_currentMesh->indices;
-        updateBuffers(); 
-        return;
+        g_subdivArena.AcquireBase(*mesh, result.verts, result.indices);
+        return true;
     }
 
-    // Setup Topology
-    Far::TopologyDescriptor desc;
-    desc.numVertices = (int)g_currentMesh->vertices.size();
-    desc.numFaces = (int)g_currentMesh->vertsPerFace.size();
-    desc.numVertsPerFace = g_currentMesh->vertsPerFace.data();
-    desc.vertIndicesPerFace = (Far::Index*)g_currentMesh->indices.data();
+    auto topology = g_subdivCache.Acquire(mesh, scheme, level, useLimit);
+    if (!topology || cancelled) return false;
 
-    Sdc::SchemeType type = Sdc::SchemeType::SCHEME_LOOP;
-    Sdc::Options options;
-    options.SetVtxBoundaryInterpolation(Sdc::Options::VTX_BOUNDARY_EDGE_ONLY);
-
-    Far::TopologyRefiner *refiner = Far::TopologyRefinerFactory<Far::TopologyDescriptor>::Create(desc,
-        Far::TopologyRefinerFactory<Far::TopologyDescriptor>::Options(type, options));
-
-    refiner->RefineUniform(Far::TopologyRefiner::UniformOptions(level));
+    result.verts = g_subdivArena.AcquireVertices((size_t)topology->stencils->GetNumStencils());
+    if (useLimit) {
+        if (!g_subdivArena.EvaluateLimit(*topology, *mesh, result.verts, g_subdivCache.GetEvaluationThreads())) return false;
+    }
+    else {
+        if (!g_subdivArena.Evaluate(*topology, *mesh, result.verts, g_subdivCache.GetEvaluationThreads())) return false;
+    }
+    if (cancelled) return false;
+    result.indices = g_subdivArena.AcquireIndices(topology->indices.size());
+    std::copy(topology->indices.begin(), topology->indices.end(), result.indices.begin());
+
+    SubdivisionCache::Stats stats = g_subdivCache.GetStats();
+    std::cout << "[SubdivisionCache] hits: " << stats.hits << ", misses: " << stats.misses
+              << " (" << stats.sharedHits << " from another mesh), evictions: " << stats.evictions << ", entries: " << stats.entries
+              << " (" << stats.sharedTopologies << " shared, " << stats.uniqueTopologies << " unique, "
+              << stats.bytesSaved / (1024 * 1024) << " MB saved)\n";
+    return true;
+}
 
-    int numTotalVertices = refiner->GetNumVerticesTotal();
-    std::vector<Vertex> refinedVerts(numTotalVertices);
+// Refines only the levels between the closest retained one and the target; going back down is a copy
+bool updateIncrementalSubdivision(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, bool useLimit, const CancelFlag& cancelled, SubdivisionResult& result)
+{
+    using namespace OpenSubdiv;
 
-    // Fill Level 0
-    int numLevel0 = (int)g_currentMesh->vertices.size();
-    for (int i = 0; i < numLevel0; ++i) {
-        refinedVerts[i].pos = g_currentMesh->vertices[i];
-        refinedVerts[i].normal = glm::vec3(0,0,0); 
-        refinedVerts[i].uv = glm::vec2(0,0);
+    if (!g_incremental || g_incremental->GetMesh() != mesh || g_incremental->GetScheme() != scheme) {
+        g_incremental = std::make_unique<IncrementalSubdivision>(mesh, scheme);
+        g_incremental->SetMaxRetainedLevels(INCREMENTAL_RETAINED_LEVELS);
     }
 
-    Far::PrimvarRefiner primvarRefiner(*refiner);
-    
-    // Interpolate with Offsets
-    int srcOffset = 0;
-    int dstOffset = numLevel0; 
-
-    for (int i = 1; i <= level; ++i) {
-        Vertex* srcPtr = refinedVerts.data() + srcOffset;
-        Vertex* dstPtr = refinedVerts.data() + dstOffset;
-        primvarRefiner.Interpolate(i, srcPtr, dstPtr);
-        srcOffset = dstOffset;
-        dstOffset += refiner->GetLevel(i).GetNumVertices();
-    }
+    const RefinedLevel* refined = useLimit ? g_incremental->GetLimit(level, &cancelled) : g_incremental->GetLevel(level, &cancelled);
+    if (!refined || cancelled) return false;
 
-    // Extract Indices with Offset
-    Far::TopologyLevel const &lastLevel = refiner->GetLevel(level);
-    int numFaces = lastLevel.GetNumFaces();
-    int firstVertexOffset = srcOffset; 
-
-    for (int face = 0; face < numFaces; ++face) {
-        Far::ConstIndexArray faceVerts = lastLevel.GetFaceVertices(face);
-        if (faceVerts.size() != 3) continue;
-        g_renderIndices.push_back(faceVerts[0] + firstVertexOffset);
-        g_renderIndices.push_back(faceVerts[1] + firstVertexOffset);
-        g_renderIndices.push_back(faceVerts[2] + firstVertexOffset);
-    }
+    result.verts = g_subdivArena.AcquireVertices(refined->verts.size());
+    if (useLimit && refined->limit) evaluateLimit(*refined->limit, refined->verts.data(), result.verts.data());
+    else std::copy(refined->verts.begin(), refined->verts.end(), result.verts.begin());
+    result.indices = g_subdivArena.AcquireIndices(refined->indices.size());
+    std::copy(refined->indices.begin(), refined->indices.end(), result.indices.begin());
 
-    // Recalculate Normals
-    for(auto& v : refinedVerts) v.normal = glm::vec3(0.0f);
+    IncrementalSubdivision::Stats stats = g_incremental->GetStats();
+    std::cout << "[IncrementalSubdivision] refined: " << stats.levelsRefined << ", served: " << stats.levelsServed
+              << ", evictions: " << stats.evictions << ", retained: " << stats.retainedLevels
+              << " (" << stats.retainedBytes / (1024 * 1024) << " MB)\n";
+    return true;
+}
 
-    for (size_t i = 0; i < g_renderIndices.size(); i += 3) {
-        unsigned int idx0 = g_renderIndices[i];
-        unsigned int idx1 = g_renderIndices[i+1];
-        unsigned int idx2 = g_renderIndices[i+2];
+// Lowest-memory path: the final level is built in the result buffers and moved, never copied, into render state
+bool updateStreamingSubdivision(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int level, const CancelFlag& cancelled, SubdivisionResult& result)
+{
+    using namespace OpenSubdiv;
 
-        if (idx0 >= refinedVerts.size() || idx1 >= refinedVerts.size() || idx2 >= refinedVerts.size()) continue;
+    // Drop what the other modes retain for this mesh so the budget covers the whole process
+    g_incremental.reset();
+    g_subdivCache.Clear();
 
-        glm::vec3 v0 = refinedVerts[idx0].pos;
-        glm::vec3 v1 = refinedVerts[idx1].pos;
-        glm::vec3 v2 = refinedVerts[idx2].pos;
+    StreamingOptions options;
+    options.memoryBudget = STREAMING_MEMORY_BUDGET;
+    StreamingStats stats;
+    if (!streamSubdivision(*mesh, scheme, level, options, result.verts, result.indices, &stats, &cancelled))
+        return false;
 
-        glm::vec3 crossP = glm::cross(v1 - v0, v2 - v0);
-        if (glm::length(crossP) > 1e-10f) {
-            refinedVerts[idx0].normal += crossP;
-            refinedVerts[idx1].normal += crossP;
-            refinedVerts[idx2].normal += crossP;
-        }
+    for (const StreamingStage& stage : stats.stages) {
+        std::cout << "[StreamingSubdivision] " << stage.name << ": " << stage.TotalBytes() / (1024 * 1024) << " MB"
+                  << " (topology " << stage.topologyBytes / (1024 * 1024) << ", vertices " << stage.vertexBytes / (1024 * 1024)
+                  << ", indices " << stage.indexBytes / (1024 * 1024) << ")\n";
     }
+    std::cout << "[StreamingSubdivision] peak: " << stats.peakBytes / (1024 * 1024) << " MB / "
+              << STREAMING_MEMORY_BUDGET / (1024 * 1024) << " MB\n";
+    return true;
+}
 
-    for(auto& v : refinedVerts) {
-        float len = glm::length(v.normal);
-        if (len > 1e-10f) v.normal /= len;
-        else v.normal = glm::vec3(0,1,0);
+// Level keys pick the isolation level; the triangle budget decides the final density
+bool updateAdaptiveSubdivision(const std::shared_ptr<MeshData>& mesh, OpenSubdiv::Sdc::SchemeType scheme, int isolationLevel, size_t budget, const CancelFlag& cancelled, SubdivisionResult& result)
+{
+    using namespace OpenSubdiv;
+
+    if (!g_adaptiveTopology || g_adaptiveTopology->isolationLevel != isolationLevel || g_adaptiveTopology->scheme != scheme
+        || g_adaptiveMesh.lock() != mesh) {
+        g_adaptiveTopology = createAdaptiveTopology(*mesh, scheme, isolationLevel);
+        g_adaptiveMesh = mesh;
     }
+    if (!g_adaptiveTopology || cancelled) return false;
+
+    std::vector<Vertex> patchPoints;
+    evaluatePatchPoints(*g_adaptiveTopology, *mesh, patchPoints);
+    if (cancelled) return false;
+
+    AdaptiveOptions options;
+    options.triangleBudget = budget;
+    AdaptiveTessellation tessellation;
+    if (!tessellateAdaptive(*g_adaptiveTopology, patchPoints, options, tessellation)) return false;
+
+    result.verts = std::move(tessellation.verts);
+    result.indices = std::move(tessellation.indices);
+    std::cout << "[Adaptive] regular patches: " << g_adaptiveTopology->numRegularPatches
+              << ", irregular patches: " << g_adaptiveTopology->numIrregularPatches
+              << ", rate scale: " << tessellation.rateScale
+              << ", tris: " << result.indices.size() / 3 << " / " << budget << "\n";
+    return true;
+}
+
+// Runs on the result copy only, so cached topology and retained levels keep the refiner's order
+void optimizeDrawOrder(SubdivisionResult& result)
+{
+    Stopwatch sw;
+    optimizeVertexCache(result.indices, result.verts.size());
+    optimizeVertexFetch(result.verts, result.indices);
+    std::cout << "[VertexCache] reordered " << result.indices.size() / 3 << " tris in " << sw.ElapsedMs() << " ms\n";
+}
 
-    g_renderVerts = refinedVerts;
-    delete refiner;
-    updateBuffers();
+// Encoded on the worker right after refinement (and after caching the float result), so the render
+// thread only receives and uploads the 16-byte records
+void packResult(SubdivisionResult& result)
+{
+    TRACE_SCOPE("pack");
+    result.packingBounds = computePackingBounds(result.verts.data(), result.verts.size());
+    result.packedVerts = g_subdivArena.AcquirePacked(result.verts.size());
+    packVertices(result.verts.data(), result.verts.size(), result.packingBounds, result.packedVerts.data());
+    g_subdivArena.Release(std::move(result.verts));
+    result.verts.clear();
 }
 
-void updateBuffers()
+// Attribute layout of g_vbo for float or packed vertices; the VAO must be bound
+void setVertexLayout(bool packed)
 {
+    if (packed) {
+        // Positions as unorm16 (normalized to [0, 1] by GL); the normal stays integer because
+        // snorm conversion differs before GL 4.2, and the shader scales it itself
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, pos));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void *)offsetof(PackedVertex, uv));
+    }
+    else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+    }
+}
+
+void updateBuffers(GLenum usage)
+{
+    TRACE_SCOPE("upload");
+    TRACE_COUNTER("triangles", g_renderIndices.size() / 3);
     glBindVertexArray(g_vao);
     glBindBuffer(GL_ARRAY_BUFFER, g_vbo);
-    glBufferData(GL_ARRAY_BUFFER, g_renderVerts.size() * sizeof(Vertex), g_renderVerts.data(), GL_STATIC_DRAW);
+    if (!g_renderPacked.empty())
+        glBufferData(GL_ARRAY_BUFFER, g_renderPacked.size() * sizeof(PackedVertex), g_renderPacked.data(), usage);
+    else
+        glBufferData(GL_ARRAY_BUFFER, g_renderVerts.size() * sizeof(Vertex), g_renderVerts.data(), usage);
+    setVertexLayout(!g_renderPacked.empty());
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, g_renderIndices.size() * sizeof(unsigned int), g_renderIndices.data(), GL_STATIC_DRAW);
 }
 
+// Same vertex count every frame, so the buffer allocated by updateBuffers is only overwritten
+void updateAnimatedVertices(float time)
+{
+    g_animated->Update(g_deformer, time);
+
+    TRACE_SCOPE("upload");
+    const std::vector<Vertex>& verts = g_animated->GetVertices();
+    glBindBuffer(GL_ARRAY_BUFFER, g_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, verts.size() * sizeof(Vertex), verts.data());
+}
+
+void updateWindowTitle(GLFWwindow* window)
+{
+    size_t queueDepth = g_subdivWorker.GetQueueDepth();
+    std::string modelName = (g_modelIndex == 0) ? "Bunny" : (g_modelIndex == 1 ? "Suzanne" : "Cube");
+    std::string title = modelName + " | Level: " + std::to_string(g_currentLevel + 1) + 
+                        " | Tris: " + std::to_string(g_renderIndices.size()/3) +
+                        " | Scheme: " + (g_modelScheme[g_modelIndex] ? schemeName(*g_modelScheme[g_modelIndex]) : "auto") +
+                        (g_showWireframe ? " | Wireframe" : "") +
+                        (g_useLimitSurface ? " | Limit" : "") +
+                        (g_animate ? " | Animated" : "") +
+                        (!g_renderPacked.empty() ? " | Packed" : "") +
+                        (g_useAdaptive && !g_animate ? " | Adaptive" : "") +
+                        (g_useStreaming && !g_useAdaptive ? " | Streaming" : "") +
+                        (g_useIncremental && !g_useStreaming && !g_useAdaptive ? " | Incremental" : "") +
+                        (queueDepth ? " | Subdividing (queue: " + std::to_string(queueDepth) + ")" : "") +
+                        (TraceRecorder::Global().IsEnabled() ? " | Tracing" + g_frameStats : "");
+    glfwSetWindowTitle(window, title.c_str());
+}
+
+void stopTracing()
+{
+    TraceRecorder& recorder = TraceRecorder::Global();
+    recorder.SetEnabled(false);
+    recorder.PrintSummary(std::cout);
+    if (recorder.WriteChromeTrace(TRACE_OUTPUT_PATH))
+        std::cout << "[Trace] wrote " << recorder.Snapshot().size() << " events to " << TRACE_OUTPUT_PATH << "\n";
+    g_frameStats.clear();
+}
+
 static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
@@ -237,26 +465,102 @@ static void key_callback(GLFWwindow *window, int key, int scancode, int action,
 
     if (action == GLFW_PRESS)
     {
+        auto & resMgr = *(ResourceManager*)glfwGetWindowUserPointer(window);
+        bool needsUpdate = false;
+
         // Appy wireframe (Press '0')
         if (key == GLFW_KEY_0) {
             g_showWireframe = !g_showWireframe;
             std::cout << "Wireframe Mode: " << (g_showWireframe ? "ON" : "OFF") << std::endl;
         }
 
+        // Toggle adaptive patches (Press 'A'), halve/double the triangle budget ('[' / ']')
+        if (key == GLFW_KEY_A) {
+            g_useAdaptive = !g_useAdaptive;
+            std::cout << "Adaptive Mode: " << (g_useAdaptive ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+        if (g_useAdaptive && (key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET)) {
+            g_adaptiveBudget = key == GLFW_KEY_RIGHT_BRACKET ? g_adaptiveBudget * 2 : std::max<size_t>(g_adaptiveBudget / 2, 1000);
+            needsUpdate = true;
+        }
+
+        // Toggle limit surface evaluation (Press 'L')
+        if (key == GLFW_KEY_L) {
+            g_useLimitSurface = !g_useLimitSurface;
+            std::cout << "Limit Surface: " << (g_useLimitSurface ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+
+        // Toggle incremental level stepping vs. cached stencils (Press 'I')
+        if (key == GLFW_KEY_I) {
+            g_useIncremental = !g_useIncremental;
+            std::cout << "Incremental Stepping: " << (g_useIncremental ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+
+        // Toggle 16-byte packed vertex upload (Press 'P')
+        if (key == GLFW_KEY_P) {
+            g_packVertices = !g_packVertices;
+            std::cout << "Packed Vertices: " << (g_packVertices ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+
+        // Toggle vertex cache / fetch reordering (Press 'O')
+        if (key == GLFW_KEY_O) {
+            g_optimizeDrawOrder = !g_optimizeDrawOrder;
+            std::cout << "Draw Order Optimization: " << (g_optimizeDrawOrder ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+
+        // Toggle bounded-memory streaming refinement (Press 'S')
+        if (key == GLFW_KEY_S) {
+            g_useStreaming = !g_useStreaming;
+            std::cout << "Streaming Mode: " << (g_useStreaming ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+
+        // Toggle tracing (Press 'T')
+        if (key == GLFW_KEY_T) {
+            if (TraceRecorder::Global().IsEnabled()) {
+                stopTracing();
+            }
+            else {
+                TraceRecorder::Global().Clear();
+                TraceRecorder::Global().SetEnabled(true);
+                std::cout << "Tracing: ON" << std::endl;
+            }
+        }
+
+        // Toggle per-frame cage deformation (Press 'D')
+        if (key == GLFW_KEY_D) {
+            g_animate = !g_animate;
+            std::cout << "Animation: " << (g_animate ? "ON" : "OFF") << std::endl;
+            needsUpdate = true;
+        }
+
+        // Cycle the current model's scheme: auto, Loop, Catmull-Clark, Bilinear (Press 'C')
+        if (key == GLFW_KEY_C) {
+            using OpenSubdiv::Sdc::SchemeType;
+            std::optional<SchemeType>& scheme = g_modelScheme[g_modelIndex];
+            if (!scheme) scheme = SchemeType::SCHEME_LOOP;
+            else if (*scheme == SchemeType::SCHEME_LOOP) scheme = SchemeType::SCHEME_CATMARK;
+            else if (*scheme == SchemeType::SCHEME_CATMARK) scheme = SchemeType::SCHEME_BILINEAR;
+            else scheme.reset();
+            std::cout << "Scheme: " << (scheme ? schemeName(*scheme) : "auto") << std::endl;
+            needsUpdate = true;
+        }
+
         // Change model (+/-)
-        bool modelChanged = false;
         if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD) {
             g_modelIndex = (g_modelIndex + 1) % MAX_MODELS;
-            modelChanged = true;
+            g_currentLevel = 0;
+            needsUpdate = true;
         }
         else if (key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT) {
             g_modelIndex = (g_modelIndex - 1 + MAX_MODELS) % MAX_MODELS;
-            modelChanged = true;
-        }
-
-        if (modelChanged) {
-			auto & resMgr = *(ResourceManager*)glfwGetWindowUserPointer(window);
-            loadModelData(g_modelIndex, resMgr);
+            g_currentLevel = 0;
+            needsUpdate = true;
         }
 
         // Change subvision level (1-6)
@@ -267,14 +571,11 @@ static void key_callback(GLFWwindow *window, int key, int scancode, int action,
 
         if (newLevel != -1 && newLevel != g_currentLevel) {
             g_currentLevel = newLevel;
-            updateMeshSubdivsion(g_currentLevel);
+            needsUpdate = true;
         }
 
-        std::string modelName = (g_modelIndex == 0) ? "Bunny" : (g_modelIndex == 1 ? "Suzanne" : "Cube");
-        std::string title = modelName + " | Level: " + std::to_string(g_currentLevel + 1) + 
-                            " | Tris: " + std::to_string(g_renderIndices.size()/3) +
-                            (g_showWireframe ? " | Wireframe" : "");
-        glfwSetWindowTitle(window, title.c_str());
+        if (needsUpdate) requestSubdivision(resMgr);
+        updateWindowTitle(window);
     }
 }
 
@@ -319,12 +620,25 @@ static const char *vertex_shader_text =
     "layout(location = 2) in vec2 vTexCoord;\n"
     "uniform mat4 MVP;\n"
     "uniform mat4 ModelMatrix;\n"
+    "uniform bool PackedVertices;\n"
+    "uniform vec3 BoundsMin;\n"
+    "uniform vec3 BoundsExtent;\n"
     "out vec3 WorldNormal;\n"
     "out vec2 TexCoord;\n"
+    "vec3 octDecode(vec2 e)\n"
+    "{\n"
+    "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+    "    float t = max(-n.z, 0.0);\n"
+    "    n.x += n.x >= 0.0 ? -t : t;\n"
+    "    n.y += n.y >= 0.0 ? -t : t;\n"
+    "    return normalize(n);\n"
+    "}\n"
     "void main()\n"
     "{\n"
-    "    gl_Position = MVP * vec4(vPos, 1.0);\n"
-    "    WorldNormal = mat3(transpose(inverse(ModelMatrix))) * vNormal;\n"
+    "    vec3 pos = PackedVertices ? BoundsMin + vPos * BoundsExtent : vPos;\n"
+    "    vec3 normal = PackedVertices ? octDecode(max(vNormal.xy / 32767.0, vec2(-1.0))) : vNormal;\n"
+    "    gl_Position = MVP * vec4(pos, 1.0);\n"
+    "    WorldNormal = mat3(transpose(inverse(ModelMatrix))) * normal;\n"
     "    TexCoord = vTexCoord;\n"
     "}\n";
 
@@ -363,6 +677,15 @@ int main(void)
 	resMgr.RegisterResource("bunny", "bunny.obj");
 	resMgr.RegisterResource("suzanne", "suzanne.obj");
 	resMgr.RegisterResource("original_bunny", "original_bunny.obj");
+    resMgr.SetMemoryBudget(RESOURCE_MEMORY_BUDGET);
+    // Results cancelled by fast key repeat return their buffers like the ones the render thread swaps out
+    g_subdivWorker.SetRecycler([](SubdivisionResult&& dropped) {
+        g_subdivArena.Release(std::move(dropped.verts));
+        g_subdivArena.Release(std::move(dropped.indices));
+        g_subdivArena.Release(std::move(dropped.packedVerts));
+    });
+    // Load every model in the background so switching with +/- never waits on a parse
+    resMgr.PrefetchAll();
 
     glfwSetErrorCallback(error_callback);
     if (!glfwInit())
@@ -412,25 +735,81 @@ int main(void)
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ebo);
 
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, uv));
+    setVertexLayout(false);
 
     // Default model 0 (Bunny)
-    loadModelData(0, resMgr);
+    requestSubdivision(resMgr);
 
     const GLint mvpLocation = glGetUniformLocation(program, "MVP");
     const GLint modelMatrixLocation = glGetUniformLocation(program, "ModelMatrix");
     const GLint light_dir_location = glGetUniformLocation(program, "LightDirection");
     const GLint ambient_color_location = glGetUniformLocation(program, "AmbientColor");
     const GLint diffuse_color_location = glGetUniformLocation(program, "DiffuseColor");
+    const GLint packed_vertices_location = glGetUniformLocation(program, "PackedVertices");
+    const GLint bounds_min_location = glGetUniformLocation(program, "BoundsMin");
+    const GLint bounds_extent_location = glGetUniformLocation(program, "BoundsExtent");
 
     glEnable(GL_DEPTH_TEST);
 
+    size_t shownQueueDepth = 0;
+    Stopwatch frameStatsTimer;
     while (!glfwWindowShouldClose(window))
     {
+        TRACE_SCOPE("frame");
+
+        // Swap in finished subdivision work before drawing
+        SubdivisionResult result;
+        if (g_subdivWorker.TakeResult(result)) {
+            if (result.animated) {
+                // Allocate once at this size; frames only overwrite the vertices
+                g_animated = std::make_unique<AnimatedSubdivision>(result.mesh, std::move(result.topology));
+                g_deformer = makeWaveDeformer(*result.mesh);
+                g_animated->Update(g_deformer, (float)glfwGetTime());
+                g_renderVerts = g_animated->GetVertices();
+                g_renderIndices = g_animated->GetIndices();
+                g_renderPacked.clear();
+                updateBuffers(GL_DYNAMIC_DRAW);
+            }
+            else {
+                g_animated.reset();
+                g_renderVerts.swap(result.verts);
+                g_renderIndices.swap(result.indices);
+                g_renderPacked.swap(result.packedVerts);
+                g_renderBounds = result.packingBounds;
+                updateBuffers();
+                // The previous frame's buffers go back to the worker for the next result
+                g_subdivArena.Release(std::move(result.verts));
+                g_subdivArena.Release(std::move(result.indices));
+                g_subdivArena.Release(std::move(result.packedVerts));
+            }
+            g_currentMesh = std::move(result.mesh);
+
+            SubdivisionWorker::Stats stats = g_subdivWorker.GetStats();
+            std::cout << "[SubdivisionWorker] level " << result.level << " ready in " << result.latencyMs << " ms"
+                      << " (avg: " << stats.averageLatencyMs << " ms, max: " << stats.maxLatencyMs << " ms"
+                      << ", cancelled: " << stats.cancelled << ", queue: " << stats.queueDepth << ")\n";
+            updateWindowTitle(window);
+        }
+        if (size_t depth = g_subdivWorker.GetQueueDepth(); depth != shownQueueDepth) {
+            shownQueueDepth = depth;
+            updateWindowTitle(window);
+        }
+        // Refresh the frame percentiles once a second while recording
+        if (TraceRecorder::Global().IsEnabled() && frameStatsTimer.ElapsedMs() > 1000.0) {
+            frameStatsTimer.Reset();
+            for (const TraceStageSummary& stage : TraceRecorder::Global().Summarize()) {
+                if (stage.name != "frame") continue;
+                char text[64];
+                std::snprintf(text, sizeof(text), " | Frame p50 %.2f / p99 %.2f ms", stage.p50Ms, stage.p99Ms);
+                g_frameStats = text;
+            }
+            updateWindowTitle(window);
+        }
+
+        if (g_animated) updateAnimatedVertices((float)glfwGetTime());
+
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         float ratio = width / (float)(height > 0 ? height : 1);
@@ -461,6 +840,9 @@ int main(void)
         glUniform3f(diffuse_color_location, 0.8f, 0.8f, 0.8f);
         glm::vec3 LightDir = glm::normalize(glm::vec3(0.5f, 0.5f, 1.0f));
         glUniform3fv(light_dir_location, 1, (const GLfloat *)&LightDir);
+        glUniform1i(packed_vertices_location, g_renderPacked.empty() ? 0 : 1);
+        glUniform3fv(bounds_min_location, 1, (const GLfloat *)&g_renderBounds.min);
+        glUniform3fv(bounds_extent_location, 1, (const GLfloat *)&g_renderBounds.extent);
 
         glBindVertexArray(g_vao);
         if (!g_renderIndices.empty()) {
@@ -471,6 +853,10 @@ int main(void)
         glfwPollEvents();
     }
 
+    // Jobs reference resMgr and the worker-side globals; stop before any of them go away
+    g_subdivWorker.Stop();
+    if (TraceRecorder::Global().IsEnabled()) stopTracing();
+
     glfwDestroyWindow(window);
     glfwTerminate();
     exit(EXIT_SUCCESS);